@@ -0,0 +1,749 @@
+using namespace std;
+#include <iostream>
+#include <mutex>
+#include "CircularDynamicArray.cpp"
+#define DUMP(X) cout << "size is : " << X.length() << endl << "capacity is : " << X.capacity() << endl; for (int i=0; i< X.length();i++) cout << X[i] << " ";  cout << endl << endl;
+
+//cases for the storage modes, incremental resizing, the parallel sort, the sortedness fast paths and the rest of the array's features.
+//the expected output is in CDAFeatureTest.out (make featuretest compares against it). mirrored storage needs linux (and 4k pages for the capacities shown).
+
+//counts the threads that compare records (or read their keys), so the parallel sorts can show they really split the work.
+//a new round is started from the main thread before the sort, every thread counts itself once per round.
+std::mutex compareLock;
+int compareRound = 0;
+int comparingThreads = 0;
+thread_local int lastCompareRound = 0;
+
+void noteCompare() {
+	if (lastCompareRound != compareRound) {
+		std::lock_guard<std::mutex> hold(compareLock);
+		lastCompareRound = compareRound;
+		comparingThreads++;
+	}
+}
+
+struct Record {
+	int key;
+	int order;
+	bool operator<(const Record &other) const { noteCompare(); return key < other.key; }
+	bool operator>(const Record &other) const { noteCompare(); return other.key < key; }
+	bool operator<=(const Record &other) const { noteCompare(); return !(other.key < key); }
+	bool operator==(const Record &other) const { return key == other.key; }
+};
+
+//counts what one element type asks of the allocator, every type an array rebinds it to keeps its own count
+template <typename T>
+struct Tally {
+	typedef T value_type;
+	static int allocations;
+	static int live;
+	Tally() {}
+	template <typename U>
+	Tally(const Tally<U> &) {}
+	T *allocate(size_t n) { allocations++; live++; return std::allocator<T>().allocate(n); }
+	void deallocate(T *p, size_t n) { live--; std::allocator<T>().deallocate(p, n); }
+	bool operator==(const Tally &) const { return true; }
+	bool operator!=(const Tally &) const { return false; }
+};
+template <typename T>
+int Tally<T>::allocations = 0;
+template <typename T>
+int Tally<T>::live = 0;
+
+void incrementalResize() {
+	cout << "--- incremental resize ---" << endl;
+	CircularDynamicArray<int> C;
+	C.setResizeMode(ResizeMode::Incremental);
+	for (int i = 0; i < 9; i++) C.addEnd(i);
+	//the 9th add started moving 8 elements into a buffer of 16, most of them are still pending
+	DUMP(C)
+	// C is : 0 1 2 3 4 5 6 7 8
+	C.delFront();
+	C.delEnd();
+	C.addFront(-1);
+	C.addEnd(100);
+	DUMP(C)
+	// C is : -1 1 2 3 4 5 6 7 100
+
+	for (int i = 0; i < 40; i++) C.addEnd(i * 10);
+	for (int i = 0; i < 20; i++) C.addFront(-i);
+	for (int i = 0; i < 30; i++) C.delFront();
+	for (int i = 0; i < 30; i++) C.delEnd();
+	//shrinking while the last grow may still be pending
+	DUMP(C)
+	// C is : 10 20 30 40 50 60 70 80 90
+
+	C.delFront(3);
+	C.delEnd(3);
+	C.addFront(3);
+	DUMP(C)
+	// C is : 3 40 50 60
+	cout << "QuickSelect(2) is : " << C.QuickSelect(2) << endl << endl;  // 40
+}
+
+void mirroredGrowth() {
+	cout << "--- mirrored growth ---" << endl;
+	CircularDynamicArray<int> M;
+	M.setStorageMode(StorageMode::Mirrored);
+	cout << "capacity is : " << M.capacity() << endl;  // 1024 with 4k pages
+	for (int i = 0; i < 600; i++) M.addEnd(i);
+	for (int i = 1; i <= 400; i++) M.addFront(-i);
+	//the front now sits at the end of the buffer and the ring wraps, growing keeps that order
+	for (int i = 600; i < 1100; i++) M.addEnd(i);
+
+	CircularDynamicArray<int>::Spans spans = M.asSpans();
+	bool inOrder = spans.firstLength == M.length();
+	for (int i = 0; inOrder && i < spans.firstLength; i++) inOrder = spans.first[i] == i - 400;
+	cout << "size is : " << M.length() << endl;  // 1500
+	cout << "capacity is : " << M.capacity() << endl;  // 2048
+	cout << "spans : " << spans.firstLength << " " << spans.secondLength << endl;  // 1500 0
+	cout << "in order : " << inOrder << endl;  // 1
+	cout << "M[0] M[399] M[400] M[1499] : " << M[0] << " " << M[399] << " " << M[400] << " " << M[1499] << endl;  // -400 -1 0 1099
+
+	M.delFront(1000);
+	M.shrinkToFit();
+	cout << "after shrinking : " << M.length() << " " << M.capacity() << " " << M[0] << " " << M[499] << endl << endl;  // 500 1024 600 1099
+}
+
+void parallelSortStability() {
+	cout << "--- parallelStableSort ---" << endl;
+	//four chunks of ParallelSortMinimum (65536) elements and a bit, so four threads really are used
+	CircularDynamicArray<Record> A;
+	for (int i = 0; i < 270000; i++) {
+		Record r = { (i * 7919) % 13, i };
+		if (i % 2) A.addEnd(r);
+		else A.addFront(r);
+	}
+	CircularDynamicArray<Record> B = A;
+	A.stableSort();
+	compareRound++;
+	comparingThreads = 0;
+	B.parallelStableSort(4);
+
+	bool same = true;
+	bool stable = true;
+	for (int i = 0; i < A.length(); i++) {
+		same = same && A[i].key == B[i].key && A[i].order == B[i].order;
+		if (i > 0 && B[i - 1].key == B[i].key) {
+			//equal keys keep the order they were added in, which is descending on the front half
+			int previous = B[i - 1].order % 2 ? B[i - 1].order : -B[i - 1].order;
+			int current = B[i].order % 2 ? B[i].order : -B[i].order;
+			stable = stable && previous < current;
+		}
+	}
+	cout << "same as stableSort : " << same << endl;  // 1
+	cout << "stable : " << stable << endl;  // 1
+	cout << "more than one thread compared : " << (comparingThreads > 1) << endl;  // 1
+	cout << "first and last key : " << B[0].key << " " << B[B.length() - 1].key << endl << endl;  // 0 12
+}
+
+void sortedFastPaths() {
+	cout << "--- sortedness ---" << endl;
+	CircularDynamicArray<int> S;
+	for (int i = 1; i <= 10; i++) S.addEnd(i);
+	cout << "isSorted : " << S.isSorted() << endl;  // 1
+	cout << "QuickSelect(1) is : " << S.QuickSelect(1) << endl;  // 1
+
+	S[0] = 50;
+	cout << "after S[0] = 50, isSorted : " << S.isSorted() << endl;  // 0
+	cout << "after S[0] = 50, QuickSelect(1) is : " << S.QuickSelect(1) << endl;  // 2
+	cout << "WCSelect(10) is : " << S.WCSelect(10) << endl;  // 50
+	//both selects rearrange the elements, the flag follows what they leave behind
+	cout << "isSorted : " << S.isSorted() << endl;  // 1
+	DUMP(S)
+	// S is : 2 3 4 5 6 7 8 9 10 50
+
+	S.stableSort();
+	cout << "getElement(9) is : " << S.getElement(9) << endl;  // 50
+	cout << "isSorted : " << S.isSorted() << endl;  // 1
+	cout << "binSearch(50) is : " << S.binSearch(50) << endl;  // 9
+
+	S.emplaceEnd(0);
+	cout << "after emplaceEnd(0), QuickSelect(1) is : " << S.QuickSelect(1) << endl;  // 0
+	//QuickSelect left the 0 at the front, writing through the iterator replaces it
+	*S.begin() = 99;
+	cout << "after *begin() = 99, WCSelect(11) is : " << S.WCSelect(11) << endl;  // 99
+
+	S.stableSort();
+	S.addFront(-5);
+	S.addEnd(100);
+	cout << "isSorted : " << S.isSorted() << endl;  // 1
+	cout << "binSearch(-5) binSearch(100) : " << S.binSearch(-5) << " " << S.binSearch(100) << endl;  // 0 12
+	DUMP(S)
+	// S is : -5 2 3 4 5 6 7 8 9 10 50 99 100
+
+	//writing through getElement is seen, and the searches refuse the array until it is sorted again
+	S.getElement(0) = 1000;
+	cout << "after getElement(0) = 1000, isSorted : " << S.isSorted() << endl;  // 0
+	int found = S.binSearch(50);
+	cout << "binSearch(50) is : " << found << endl;  // -1, after the error
+	S.stableSort();
+	cout << "after sorting, binSearch(50) is : " << S.binSearch(50) << endl << endl;  // 9
+}
+
+void fixedCapacity() {
+	cout << "--- fixed capacity ---" << endl;
+	CircularDynamicArray<int> F;
+	F.setFixedCapacity(4);
+	for (int i = 1; i <= 6; i++) F.addEnd(i);
+	DUMP(F)
+	// F is : 3 4 5 6
+	int more[] = { 7, 8, 9, 10, 11 };
+	F.addEndRange(more, 5);
+	DUMP(F)
+	// F is : 8 9 10 11
+	cout << "dropped : " << F.droppedCount() << endl << endl;  // 7
+}
+
+void inlineStorage() {
+	cout << "--- inline storage ---" << endl;
+	CircularDynamicArray<int, 4> I(5);
+	for (int i = 0; i < 4; i++) I.delEnd();
+	//one element left in a heap buffer of 5, it shrinks into the 4 inline slots
+	DUMP(I)
+	// I is : 0
+	I.addEnd(1);
+	I.addEnd(2);
+	I.addEnd(3);
+	I.addEnd(4);
+	//full inline slots grow back onto the heap
+	DUMP(I)
+	// I is : 0 1 2 3 4
+
+	I.delEnd(4);
+	I.addFront(-1);
+	I.addFront(-2);
+	I.addFront(-3);
+	//back in the inline slots and wrapped around them, sorting unwraps them without allocating
+	I.stableSort();
+	DUMP(I)
+	// I is : -3 -2 -1 0
+
+	CircularDynamicArray<string, 3> W;
+	for (int i = 0; i < 10; i++) W.addEnd(string(i + 1, 'a' + i));
+	W.delFront(9);
+	W.addFront("z");
+	W.addEnd("y");
+	DUMP(W)
+	// W is : z jjjjjjjjjj y
+	W.addEnd("x");
+	DUMP(W)
+	// W is : z jjjjjjjjjj y x
+}
+
+void iteratorsAndSpans() {
+	cout << "--- iterators and spans ---" << endl;
+	CircularDynamicArray<int> A;
+	for (int i = 0; i < 6; i++) A.addEnd(i * 3 % 7);
+	for (int i = 0; i < 4; i++) A.addFront(10 + i);
+	//the front was added last, so the buffer wraps
+	std::sort(A.begin(), A.end());
+	int sum = 0;
+	for (CircularDynamicArray<int>::const_iterator it = A.begin(); it != A.end(); ++it) sum += *it;
+	cout << "sum is : " << sum << endl;  // 63
+	cout << "end - begin is : " << (A.end() - A.begin()) << endl;  // 10
+	cout << "lower_bound(5) is at : " << (std::lower_bound(A.begin(), A.end(), 5) - A.begin()) << endl;  // 4
+	DUMP(A)
+	// A is : 0 1 2 3 5 6 10 11 12 13
+
+	A.delEnd(3);
+	for (int i = 0; i < 3; i++) A.addFront(20 + i);
+	CircularDynamicArray<int>::Spans spans = A.asSpans();
+	cout << "spans : " << spans.firstLength << " " << spans.secondLength << endl;  // 5 5
+	cout << "first span : ";
+	for (int i = 0; i < spans.firstLength; i++) cout << spans.first[i] << " ";
+	cout << endl << "second span : ";
+	for (int i = 0; i < spans.secondLength; i++) cout << spans.second[i] << " ";
+	cout << endl;
+	// first span : 22 21 20 0 1
+	// second span : 2 3 5 6 10
+
+	//segmented storage has no spans, it comes back empty without an error and contiguousRun walks it instead
+	A.setStorageMode(StorageMode::Segmented);
+	spans = A.asSpans();
+	cout << "segmented spans : " << spans.firstLength << " " << spans.secondLength << endl;  // 0 0
+	int runs = 0;
+	for (int i = 0; i < A.length(); runs++) {
+		const int *run;
+		i += A.contiguousRun(i, run);
+	}
+	cout << "segmented runs : " << runs << endl << endl;  // 1
+}
+
+void allocatorScratch() {
+	cout << "--- allocator ---" << endl;
+	{
+		CircularDynamicArray<long, 0, Tally<long>> A;
+		for (long i = 0; i < 140000; i++) A.addEnd((i * 7919) % 140009);
+		int ks[] = { 1, 70000, 140000 };
+		CircularDynamicArray<long, 0, Tally<long>> picked = A.multiSelect(ks, 3);
+		cout << "multiSelect : " << picked[0] << " " << picked[1] << " " << picked[2] << endl;  // 0 70000 140008
+		cout << "index scratch from the allocator : " << (Tally<int>::allocations > 0) << endl;  // 1
+
+		A.parallelStableSort(2);
+		A.parallelRadixSort(32, 2);
+		cout << "worker threads from the allocator : " << Tally<std::thread>::allocations << endl;  // 12, one for every parallel step of the two sorts
+
+		CircularDynamicArraySearchIndex<long, Tally<long>> index = A.buildSearchIndex();
+		cout << "index keys from the allocator : " << Tally<unsigned char>::allocations << endl;  // 1
+		cout << "find(70019) is : " << index.find(70019) << endl;  // 70018
+	}
+	//everything went back to the allocator it came from
+	cout << "still allocated : " << Tally<long>::live << " " << Tally<int>::live << " " << Tally<std::thread>::live << " " << Tally<unsigned char>::live << endl << endl;  // 0 0 0 0
+}
+
+void segmentedStorage() {
+	cout << "--- segmented storage ---" << endl;
+	CircularDynamicArray<int> G;
+	G.setStorageMode(StorageMode::Segmented);
+	for (int i = 0; i < 600; i++) G.addEnd(i);
+	for (int i = 1; i <= 300; i++) G.addFront(-i);
+	//elements never move once they are added, so a pointer taken now is still good after the array grows
+	const int *first = &G.getElement(300);
+	for (int i = 600; i < 2000; i++) G.addEnd(i);
+	cout << "size is : " << G.length() << endl;  // 2300
+	cout << "the 0 didn't move : " << (first == &G.getElement(300)) << endl;  // 1
+	cout << "G[0] G[299] G[300] G[2299] : " << G[0] << " " << G[299] << " " << G[300] << " " << G[2299] << endl;  // -300 -1 0 1999
+
+	G.delFront(1000);
+	G.delEnd(1000);
+	int runs = 0;
+	for (int i = 0; i < G.length(); runs++) {
+		const int *run;
+		i += G.contiguousRun(i, run);
+	}
+	cout << "after deleting : " << G.length() << " " << G[0] << " " << G[G.length() - 1] << " in " << runs << " runs" << endl;  // 300 700 999 in 2 runs
+
+	//sorting and switching back work on the blocks too
+	for (int i = 0; i < 5; i++) G.addFront(i * 1000);
+	G.stableSort();
+	G.setStorageMode(StorageMode::Contiguous);
+	cout << "contiguous again : " << G.length() << " " << G.capacity() << " " << G[0] << " " << G[304] << endl << endl;  // 305 305 0 4000
+}
+
+void bulkRanges() {
+	cout << "--- bulk ranges ---" << endl;
+	CircularDynamicArray<int> R;
+	int front[] = { 1, 2, 3 };
+	int back[] = { 7, 8, 9, 10, 11 };
+	R.addEnd(5);
+	R.addFront(4);
+	R.addEndRange(back, 5);
+	R.addFrontRange(front, 3);
+	//the ranges keep their order at both ends
+	DUMP(R)
+	// R is : 1 2 3 4 5 7 8 9 10 11
+
+	R.delFront(2);
+	R.delEnd(4);
+	DUMP(R)
+	// R is : 3 4 5 7
+
+	//asking for more than there is (or a negative count) deletes nothing
+	R.delEnd(5);
+	R.delFront(-1);
+	DUMP(R)
+	// R is : 3 4 5 7
+
+	int many[100];
+	for (int i = 0; i < 100; i++) many[i] = i;
+	R.addFrontRange(many, 100);
+	R.delEnd(R.length());
+	cout << "after deleting everything : " << R.length() << " " << R.capacity() << endl;  // 0 0
+	R.addEndRange(back, 2);
+	DUMP(R)
+	// R is : 7 8
+}
+
+void radixSorts() {
+	cout << "--- radix sort ---" << endl;
+	CircularDynamicArray<int> N;
+	int values[] = { 5, -3, 1000000, -1000000, 0, 42, -1, 7 };
+	N.addEndRange(values, 8);
+	//every bit of the key, so negative numbers come first
+	N.radixSort(32);
+	DUMP(N)
+	// N is : -1000000 -3 -1 0 5 7 42 1000000
+
+	CircularDynamicArray<long long> L;
+	L.addEnd(1LL << 40);
+	L.addEnd(-(1LL << 50));
+	L.addEnd(3);
+	L.addFront((1LL << 62) + 1);
+	L.addFront(-7);
+	L.radixSort(64);
+	DUMP(L)
+	// L is : -1125899906842624 -7 3 1099511627776 4611686018427387905
+
+	//sorting by a key keeps elements with the same key in the order they were in
+	CircularDynamicArray<Record> K;
+	for (int i = 0; i < 10; i++) {
+		Record r = { 3 - i % 4, i };
+		K.addEnd(r);
+	}
+	K.radixSortBy([](const Record &r) { return r.key; });
+	cout << "by key : ";
+	for (int i = 0; i < K.length(); i++) cout << K[i].key << "/" << K[i].order << " ";
+	cout << endl << endl;
+	// by key : 0/3 0/7 1/2 1/6 2/1 2/5 2/9 3/0 3/4 3/8
+}
+
+void parallelRadixSorts() {
+	cout << "--- parallel radix sort ---" << endl;
+	//two ParallelSortMinimum (65536) sized chunks and a bit, so two threads really are used
+	CircularDynamicArray<long long> A;
+	for (long long i = 0; i < 140000; i++) A.addFront((i * 2654435761LL) % 1000003 - 500000);
+	CircularDynamicArray<long long> B = A;
+	A.radixSort(64);
+	B.parallelRadixSort(64, 2);
+	bool same = true;
+	for (int i = 0; i < A.length(); i++) same = same && A[i] == B[i];
+	cout << "same as radixSort : " << same << endl;  // 1
+	cout << "first and last : " << B[0] << " " << B[B.length() - 1] << endl;  // -500000 500001
+
+	CircularDynamicArray<Record> R;
+	for (int i = 0; i < 140000; i++) {
+		Record r = { i % 100, i };
+		R.addEnd(r);
+	}
+	compareRound++;
+	comparingThreads = 0;
+	R.parallelRadixSortBy([](const Record &r) { noteCompare(); return r.key; }, 2);
+	bool stable = true;
+	for (int i = 1; i < R.length(); i++) stable = stable && (R[i - 1].key < R[i].key || R[i - 1].order < R[i].order);
+	cout << "stable : " << stable << endl;  // 1
+	cout << "more than one thread read keys : " << (comparingThreads > 1) << endl << endl;  // 1
+}
+
+//true when QuickSelect (or WCSelect) gives the kth smallest for every k in steps of step, on a fresh copy each time
+bool selectsMatch(const CircularDynamicArray<int> &data, bool worstCase, int step) {
+	CircularDynamicArray<int> sorted = data;
+	sorted.stableSort();
+	for (int k = 1; k <= data.length(); k += step) {
+		CircularDynamicArray<int> copy = data;
+		int found = worstCase ? copy.WCSelect(k) : copy.QuickSelect(k);
+		if (found != sorted[k - 1]) return false;
+	}
+	return true;
+}
+
+void introSelect() {
+	cout << "--- QuickSelect ---" << endl;
+	CircularDynamicArray<int> Q;
+	int values[] = { 9, 2, 7, 4, 5, 6, 3, 8, 1 };
+	Q.addEndRange(values, 9);
+	cout << "QuickSelect(1) (5) (9) : " << Q.QuickSelect(1) << " " << Q.QuickSelect(5) << " " << Q.QuickSelect(9) << endl;  // 1 5 9
+
+	//inputs that pick bad pivots for a plain median of three quickselect
+	CircularDynamicArray<int> descending, organPipe, sawtooth;
+	for (int i = 0; i < 20000; i++) {
+		descending.addEnd(20000 - i);
+		organPipe.addEnd(i < 10000 ? i : 20000 - i);
+		sawtooth.addEnd(i % 64 * 1000 + i / 64);
+	}
+	cout << "descending : " << selectsMatch(descending, false, 997) << endl;  // 1
+	cout << "organ pipe : " << selectsMatch(organPipe, false, 997) << endl;  // 1
+	cout << "sawtooth : " << selectsMatch(sawtooth, false, 997) << endl;  // 1
+	int outOfRange = Q.QuickSelect(0);
+	cout << "QuickSelect(0) is : " << outOfRange << endl << endl;  // 0, after the error
+}
+
+//an int that counts how often it is compared
+long long countedCompares = 0;
+struct Counted {
+	int value;
+	bool operator<(const Counted &other) const { countedCompares++; return value < other.value; }
+	bool operator>(const Counted &other) const { countedCompares++; return other.value < value; }
+	bool operator<=(const Counted &other) const { countedCompares++; return !(other.value < value); }
+	bool operator==(const Counted &other) const { countedCompares++; return value == other.value; }
+};
+
+void duplicateSelect() {
+	cout << "--- selecting among duplicates ---" << endl;
+	//a two way partition puts every equal element on one side, which makes mostly equal input quadratic.
+	//the three way partition keeps the equal ones in the middle, so this stays a handful of compares per element.
+	for (int distinct = 1; distinct <= 4; distinct *= 2) {
+		CircularDynamicArray<Counted> same;
+		for (int i = 0; i < 50000; i++) {
+			//a few larger ones keep it from already being sorted, which would skip the partitioning
+			Counted c = { i % 997 == 0 ? 9 : i % distinct };
+			same.addEnd(c);
+		}
+		CircularDynamicArray<Counted> copy = same;
+		countedCompares = 0;
+		int quick = same.QuickSelect(25000).value;
+		long long quickCompares = countedCompares;
+		countedCompares = 0;
+		int worst = copy.WCSelect(25000).value;
+		cout << distinct << " common values : " << quick << " " << worst << ", under 20 compares per element : "
+			 << (quickCompares < 20 * 50000) << " " << (countedCompares < 20 * 50000) << endl;
+	}
+	// 1 common values : 0 0, under 20 compares per element : 1 1
+	// 2 common values : 1 1, under 20 compares per element : 1 1
+	// 4 common values : 2 2, under 20 compares per element : 1 1
+	cout << endl;
+}
+
+void batchSelect() {
+	cout << "--- multiSelect and quantiles ---" << endl;
+	CircularDynamicArray<int> M;
+	for (int i = 0; i < 100; i++) M.addEnd((i * 37) % 100 + 1);
+	//any order and repeats, the answers come back in the order they were asked for
+	int ks[] = { 100, 1, 50, 50, 10 };
+	CircularDynamicArray<int> picked = M.multiSelect(ks, 5);
+	DUMP(picked)
+	// picked is : 100 1 50 50 10
+
+	CircularDynamicArray<int> q = M.quantiles({ 0, .25, .5, .99, 1 });
+	DUMP(q)
+	// q is : 1 25 50 99 100
+
+	int bad[] = { 3, 101 };
+	CircularDynamicArray<int> none = M.multiSelect(bad, 2);
+	CircularDynamicArray<int> noneEither = M.quantiles({ .5, 1.5 });
+	cout << "out of range : " << none.length() << " " << noneEither.length() << endl << endl;  // 0 0, after two errors
+}
+
+void worstCaseSelect() {
+	cout << "--- WCSelect ---" << endl;
+	CircularDynamicArray<int> descending, organPipe, random;
+	for (int i = 0; i < 20000; i++) {
+		descending.addEnd(20000 - i);
+		organPipe.addEnd(i < 10000 ? i : 20000 - i);
+		random.addEnd((i * 7919) % 20011);
+	}
+	cout << "descending : " << selectsMatch(descending, true, 997) << endl;  // 1
+	cout << "organ pipe : " << selectsMatch(organPipe, true, 997) << endl;  // 1
+	cout << "random : " << selectsMatch(random, true, 997) << endl;  // 1
+
+	//the medians of medians are gathered in place, so the select never asks the allocator for anything
+	CircularDynamicArray<long, 0, Tally<long>> T;
+	for (long i = 0; i < 20000; i++) T.addFront((i * 7919) % 20011);
+	int before = Tally<long>::allocations + Tally<int>::allocations;
+	long median = T.WCSelect(10000);
+	cout << "WCSelect(10000) is : " << median << endl;  // 10005
+	cout << "allocations : " << Tally<long>::allocations + Tally<int>::allocations - before << endl << endl;  // 0
+}
+
+//linearSearch, count and findAll against a plain loop over every value in 0..range, on whatever layout data has
+template <typename T>
+bool scansMatch(CircularDynamicArray<T> &data, int range) {
+	for (int v = 0; v <= range; v++) {
+		T key = (T)v;
+		int first = -1, matches = 0;
+		for (int i = data.length() - 1; i >= 0; i--) {
+			if (data.getElement(i) == key) {
+				first = i;
+				matches++;
+			}
+		}
+		CircularDynamicArray<int> all;
+		if (data.linearSearch(key) != first || data.count(key) != matches || data.findAll(key, all) != matches) return false;
+		for (int i = 0; i < all.length(); i++) {
+			if (data.getElement(all[i]) != key || (i > 0 && all[i - 1] >= all[i])) return false;
+		}
+	}
+	return true;
+}
+
+void vectorScans() {
+	cout << "--- linearSearch, count and findAll ---" << endl;
+	CircularDynamicArray<int> I;
+	CircularDynamicArray<long long> L;
+	CircularDynamicArray<float> F;
+	CircularDynamicArray<double> D;
+	//odd lengths and a wrapped buffer, so the vector loops have tails and two runs to cover
+	for (int i = 0; i < 1003; i++) {
+		I.addEnd(i * 7 % 101);
+		L.addFront(i * 7 % 101);
+		F.addEnd((float)(i * 7 % 101));
+		D.addFront(i * 7 % 101);
+	}
+	cout << "int : " << scansMatch(I, 101) << endl;  // 1
+	cout << "long long : " << scansMatch(L, 101) << endl;  // 1
+	cout << "float : " << scansMatch(F, 101) << endl;  // 1
+	cout << "double : " << scansMatch(D, 101) << endl;  // 1
+	I.setStorageMode(StorageMode::Segmented);
+	cout << "segmented int : " << scansMatch(I, 101) << endl;  // 1
+
+	CircularDynamicArray<int> where;
+	cout << "count(3) findAll(3) linearSearch(3) : " << I.count(3) << " " << I.findAll(3, where) << " " << I.linearSearch(3) << endl;  // 10 10 87
+	cout << "linearSearch(-1) is : " << I.linearSearch(-1) << endl << endl;  // -1
+}
+
+//binSearch, lowerBound and binSearchBatch against std::lower_bound for every key from below the smallest to past the largest
+bool searchesMatch(CircularDynamicArray<int> &sorted, int largest) {
+	const CircularDynamicArray<int> &view = sorted;
+	int keys[1000];
+	int found[1000];
+	int n = 0;
+	for (int key = -2; key <= largest + 2; key++) {
+		int expected = (int)(std::lower_bound(view.begin(), view.end(), key) - view.begin());
+		if (sorted.lowerBound(key) != expected) return false;
+		int hit = expected < view.length() && view[expected] == key ? expected : -1;
+		if (sorted.binSearch(key) != hit) return false;
+		keys[n++] = key;
+	}
+	//n isn't a multiple of the 16 searches the batch runs side by side
+	sorted.binSearchBatch(keys, n, found);
+	for (int i = 0; i < n; i++) {
+		if (found[i] != sorted.binSearch(keys[i])) return false;
+	}
+	return true;
+}
+
+void binarySearches() {
+	cout << "--- binary searches ---" << endl;
+	//every even number twice, so there are duplicates and missing keys
+	CircularDynamicArray<int> B;
+	for (int i = 100; i >= 0; i -= 2) {
+		B.addFront(i);
+		B.addFront(i);
+	}
+	B.delFront();
+	B.addFront(0);
+	cout << "wrapped : " << searchesMatch(B, 100) << endl;  // 1
+	cout << "binSearch(40) lowerBound(41) : " << B.binSearch(40) << " " << B.lowerBound(41) << endl;  // 40 42
+
+	B.setStorageMode(StorageMode::Mirrored);
+	cout << "mirrored : " << searchesMatch(B, 100) << endl;  // 1
+	B.setStorageMode(StorageMode::Segmented);
+	cout << "segmented : " << searchesMatch(B, 100) << endl;  // 1
+
+	//some of the elements still in the old buffer of an incremental resize
+	CircularDynamicArray<int> P;
+	P.setResizeMode(ResizeMode::Incremental);
+	for (int i = 0; i < 257; i++) P.addEnd(i * 3);
+	cout << "resizing : " << searchesMatch(P, 768) << endl;  // 1
+
+	CircularDynamicArray<int> empty;
+	int key = 5;
+	int result = 0;
+	empty.binSearchBatch(&key, 1, &result);
+	cout << "empty : " << empty.binSearch(5) << " " << empty.lowerBound(5) << " " << result << endl << endl;  // -1 0 -1
+}
+
+void searchIndex() {
+	cout << "--- search index ---" << endl;
+	//every tree shape up to a few levels, with duplicates, checked against the array's own searches
+	bool same = true;
+	for (int n = 0; n <= 70; n++) {
+		CircularDynamicArray<int> S;
+		for (int i = 0; i < n; i++) S.addEnd(i / 2 * 3);
+		CircularDynamicArraySearchIndex<int> index = S.buildSearchIndex();
+		same = same && index.length() == n;
+		for (int key = -1; key <= n * 2; key++) {
+			same = same && index.find(key) == S.binSearch(key) && index.lowerBound(key) == S.lowerBound(key);
+			same = same && index.contains(key) == (S.binSearch(key) >= 0);
+		}
+	}
+	cout << "same as binSearch and lowerBound : " << same << endl;  // 1
+
+	CircularDynamicArray<int> S;
+	for (int i = 0; i < 10; i++) S.addEnd(i * 10);
+	CircularDynamicArraySearchIndex<int> index = S.buildSearchIndex();
+	//a snapshot, later changes to the array don't show up in it
+	S.delFront(5);
+	CircularDynamicArraySearchIndex<int> copy = index;
+	copy = S.buildSearchIndex();
+	cout << "find(30) in the index, its copy : " << index.find(30) << " " << copy.find(30) << endl;  // 3 -1
+	cout << "lowerBound(55) in the copy : " << copy.lowerBound(55) << endl;  // 1
+
+	S.addEnd(1);
+	CircularDynamicArraySearchIndex<int> refused = S.buildSearchIndex();
+	cout << "unsorted array gives an empty index : " << refused.length() << endl << endl;  // 0, after the error
+}
+
+void accessPolicies() {
+	cout << "--- access policies ---" << endl;
+	//Report prints the error and carries on
+	CircularDynamicArray<int> R;
+	R.addEnd(1);
+	R[5] = 9;
+	R.delEnd();
+	R.delEnd();
+	cout << "Report : " << R.length() << endl;  // 0, after two errors
+
+	//Throw reports every misuse as std::out_of_range and leaves the array as it was
+	CircularDynamicArray<int, 0, std::allocator<int>, AccessPolicy::Throw> T;
+	T.addEnd(2);
+	T.addEnd(1);
+	int thrown = 0;
+	try { T[2]; } catch (const std::out_of_range &) { thrown++; }
+	try { T.delEnd(3); } catch (const std::out_of_range &) { thrown++; }
+	try { T.binSearch(1); } catch (const std::out_of_range &) { thrown++; }
+	T.setStorageMode(StorageMode::Segmented);
+	try { T.asSpans(); } catch (const std::out_of_range &) { thrown++; }
+	T.delEnd();
+	T.delEnd();
+	try { T.delFront(); } catch (const std::out_of_range &) { thrown++; }
+	cout << "Throw : " << thrown << " thrown, " << T.length() << endl;  // 5 thrown, 0
+
+	//Unchecked trusts the caller, correct use behaves the same
+	CircularDynamicArray<int, 0, std::allocator<int>, AccessPolicy::Unchecked> U;
+	for (int i = 0; i < 5; i++) U.addFront(i);
+	U[0] = 10;
+	U.delEnd();
+	cout << "Unchecked : " << U[0] << " " << U[3] << " " << U.length() << endl << endl;  // 10 1 4
+}
+
+//a string that counts how often it is copied and moved
+struct Tracked {
+	static int copies;
+	static int moves;
+	string text;
+	Tracked() {}
+	Tracked(const string &text) : text(text) {}
+	Tracked(const char *first, int count) : text(first, count) {}
+	Tracked(const Tracked &other) : text(other.text) { copies++; }
+	Tracked(Tracked &&other) : text(std::move(other.text)) { moves++; }
+	Tracked &operator=(const Tracked &other) { text = other.text; copies++; return *this; }
+	Tracked &operator=(Tracked &&other) { text = std::move(other.text); moves++; return *this; }
+};
+int Tracked::copies = 0;
+int Tracked::moves = 0;
+
+void emplaceAndMove() {
+	cout << "--- emplace and move ---" << endl;
+	CircularDynamicArray<Tracked> E;
+	E.reserve(8);
+	//built right in its slot from the constructor arguments
+	const Tracked &built = E.emplaceEnd("abcdef", 3);
+	E.emplaceFront("xyz", 2);
+	cout << "emplaced : " << E[0].text << " " << built.text << ", copies and moves : " << Tracked::copies << " " << Tracked::moves << endl;  // xy abc, copies and moves : 0 0
+
+	Tracked moved("moved");
+	Tracked copied("copied");
+	E.addEnd(std::move(moved));
+	E.addFront(copied);
+	cout << "added : " << E[0].text << " " << E[3].text << ", copies and moves : " << Tracked::copies << " " << Tracked::moves << endl;  // copied moved, copies and moves : 1 1
+
+	//the array is full, so emplacing a copy of its own element has to build it before the buffer moves
+	while (E.length() < E.capacity()) E.emplaceEnd("pad", 3);
+	E.emplaceEnd(E[1]);
+	cout << "copied from itself while growing : " << E[E.length() - 1].text << " " << E.length() << endl << endl;  // xy 9
+}
+
+int main() {
+	incrementalResize();
+	mirroredGrowth();
+	parallelSortStability();
+	sortedFastPaths();
+	fixedCapacity();
+	inlineStorage();
+	iteratorsAndSpans();
+	allocatorScratch();
+	segmentedStorage();
+	bulkRanges();
+	radixSorts();
+	parallelRadixSorts();
+	introSelect();
+	duplicateSelect();
+	batchSelect();
+	worstCaseSelect();
+	vectorScans();
+	binarySearches();
+	searchIndex();
+	accessPolicies();
+	emplaceAndMove();
+}
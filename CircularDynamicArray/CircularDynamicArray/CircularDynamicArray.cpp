@@ -10,32 +10,745 @@
 
 using namespace std;
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+//how the capacity of the array is chosen when it has to grow or shrink.
+//Exact keeps whatever capacity was asked for, PowerOfTwo rounds it up so that
+//wrapping an index around the buffer is a mask instead of a division.
+enum class CapacityPolicy
+{
+    Exact,
+    PowerOfTwo
+};
+
+//where the elements live. Contiguous keeps one circular buffer that is copied when it grows,
+//Segmented keeps a circular map of fixed size blocks (like a deque) so growing only copies the
+//map and elements never move once they are added. Mirrored (linux only, trivially copyable types only)
+//maps the pages of the buffer a second time right after it, so the elements are one contiguous run even
+//when they wrap, and growing maps more pages instead of copying them. it always resizes immediately.
+enum class StorageMode
+{
+    Contiguous,
+    Segmented,
+    Mirrored
+};
+
+//what happens when a contiguous buffer has to grow or shrink. Immediate moves every element at once
+//(O(1) amortized but one O(n) operation), Incremental keeps the old buffer around and moves a few
+//elements on each following addEnd/addFront/delEnd/delFront so every operation is O(1).
+enum class ResizeMode
+{
+    Immediate,
+    Incremental
+};
+
+//what operator[], delEnd and delFront do when they are asked for something the array can't do (an index out of
+//bounds, deleting from an empty array). it is a template argument, so the check costs nothing when it is off.
+//Report prints an error and returns errorElem (or deletes nothing), Assert only checks in debug builds,
+//Throw throws std::out_of_range and Unchecked trusts the caller completely.
+enum class AccessPolicy
+{
+    Report,
+    Assert,
+    Throw,
+    Unchecked
+};
+
+//random access iterator over a CircularDynamicArray. it keeps the logical index, so it works for every
+//storage mode and skips the bounds check (and error print) of operator[].
+//Container is the (possibly const) array type and Value the (possibly const) element type.
+template <typename Container, typename Value>
+class CircularDynamicArrayIterator
+{
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef typename std::remove_const<Value>::type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value *pointer;
+    typedef Value &reference;
+
+    CircularDynamicArrayIterator() : container(nullptr), index(0) {}
+    CircularDynamicArrayIterator(Container *container, difference_type index) : container(container), index(index) {}
+
+    //lets an iterator be used where a const_iterator is expected
+    template <typename OtherContainer, typename OtherValue>
+    CircularDynamicArrayIterator(const CircularDynamicArrayIterator<OtherContainer, OtherValue> &other) : container(other.container), index(other.index) {}
+
+    reference operator*() const { return container->elementAt((int)index); }
+    pointer operator->() const { return &container->elementAt((int)index); }
+    reference operator[](difference_type n) const { return container->elementAt((int)(index + n)); }
+
+    CircularDynamicArrayIterator &operator++() { index++; return *this; }
+    CircularDynamicArrayIterator &operator--() { index--; return *this; }
+    CircularDynamicArrayIterator operator++(int) { CircularDynamicArrayIterator old = *this; index++; return old; }
+    CircularDynamicArrayIterator operator--(int) { CircularDynamicArrayIterator old = *this; index--; return old; }
+    CircularDynamicArrayIterator &operator+=(difference_type n) { index += n; return *this; }
+    CircularDynamicArrayIterator &operator-=(difference_type n) { index -= n; return *this; }
+    CircularDynamicArrayIterator operator+(difference_type n) const { return CircularDynamicArrayIterator(container, index + n); }
+    CircularDynamicArrayIterator operator-(difference_type n) const { return CircularDynamicArrayIterator(container, index - n); }
+    friend CircularDynamicArrayIterator operator+(difference_type n, const CircularDynamicArrayIterator &it) { return it + n; }
+    difference_type operator-(const CircularDynamicArrayIterator &other) const { return index - other.index; }
+
+    bool operator==(const CircularDynamicArrayIterator &other) const { return index == other.index; }
+    bool operator!=(const CircularDynamicArrayIterator &other) const { return index != other.index; }
+    bool operator<(const CircularDynamicArrayIterator &other) const { return index < other.index; }
+    bool operator>(const CircularDynamicArrayIterator &other) const { return index > other.index; }
+    bool operator<=(const CircularDynamicArrayIterator &other) const { return index <= other.index; }
+    bool operator>=(const CircularDynamicArrayIterator &other) const { return index >= other.index; }
+
+private:
+    template <typename, typename>
+    friend class CircularDynamicArrayIterator;
+
+    Container *container;
+    difference_type index;
+};
+
+//whether elements can be compared with <. sortedness is only tracked for types that can.
+template <typename T, typename = void>
+struct CircularDynamicArrayOrder
+{
+    static bool inOrder(const T &, const T &) { return false; }
+};
+
+template <typename T>
+struct CircularDynamicArrayOrder<T, decltype(void(std::declval<const T &>() < std::declval<const T &>()))>
+{
+    static bool inOrder(const T &first, const T &second) { return !(second < first); }
+};
+
+//equality scans over one contiguous run, used by linearSearch, count and findAll (and the sortedness check in isSorted).
+//this is the plain version, every element type that isn't a 4 or 8 byte integer or float uses it.
+template <typename T, bool Vectorized = (std::is_integral<T>::value || std::is_floating_point<T>::value) &&
+                                        !std::is_same<T, bool>::value && (sizeof(T) == 4 || sizeof(T) == 8)>
+struct CircularDynamicArrayScan
+{
+    static int find(const T *run, int length, const T &key)
+    {
+        for (int i = 0; i < length; i++)
+        {
+            if (run[i] == key)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static int count(const T *run, int length, const T &key)
+    {
+        int matches = 0;
+        for (int i = 0; i < length; i++)
+        {
+            matches += run[i] == key;
+        }
+        return matches;
+    }
+
+    static bool sorted(const T *run, int length)
+    {
+        for (int i = 1; i < length; i++)
+        {
+            if (run[i] < run[i - 1])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+
+//the lane operations for one vector width and element kind. equal gives all ones in every lane that matches,
+//mask packs those into one bit per lane and tally counts them up lane by lane.
+template <int Width, bool Floating>
+struct CircularDynamicArrayAvx2Lanes;
+template <int Width, bool Floating>
+struct CircularDynamicArraySse2Lanes;
+
+template <>
+struct CircularDynamicArrayAvx2Lanes<4, false>
+{
+    static const int Lanes = 8;
+    __attribute__((target("avx2"))) static __m256i splat(const void *key) { int k; memcpy(&k, key, 4); return _mm256_set1_epi32(k); }
+    __attribute__((target("avx2"))) static __m256i equal(const void *p, __m256i key) { return _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)p), key); }
+    __attribute__((target("avx2"))) static unsigned mask(__m256i eq) { return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq)); }
+    __attribute__((target("avx2"))) static __m256i tally(__m256i total, __m256i eq) { return _mm256_sub_epi32(total, eq); }
+    //lanes where p[i + 1] < p[i], unsigned compares flip the sign bit of both sides first
+    template <bool Signed>
+    __attribute__((target("avx2"))) static __m256i descending(const void *p)
+    {
+        __m256i flip = _mm256_set1_epi32(Signed ? 0 : (int)0x80000000u);
+        __m256i current = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)p), flip);
+        __m256i next = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)((const char *)p + 4)), flip);
+        return _mm256_cmpgt_epi32(current, next);
+    }
+};
+
+template <>
+struct CircularDynamicArrayAvx2Lanes<8, false>
+{
+    static const int Lanes = 4;
+    __attribute__((target("avx2"))) static __m256i splat(const void *key) { long long k; memcpy(&k, key, 8); return _mm256_set1_epi64x(k); }
+    __attribute__((target("avx2"))) static __m256i equal(const void *p, __m256i key) { return _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)p), key); }
+    __attribute__((target("avx2"))) static unsigned mask(__m256i eq) { return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(eq)); }
+    __attribute__((target("avx2"))) static __m256i tally(__m256i total, __m256i eq) { return _mm256_sub_epi64(total, eq); }
+    template <bool Signed>
+    __attribute__((target("avx2"))) static __m256i descending(const void *p)
+    {
+        __m256i flip = _mm256_set1_epi64x(Signed ? 0 : (long long)0x8000000000000000ull);
+        __m256i current = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)p), flip);
+        __m256i next = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)((const char *)p + 8)), flip);
+        return _mm256_cmpgt_epi64(current, next);
+    }
+};
+
+template <>
+struct CircularDynamicArrayAvx2Lanes<4, true>
+{
+    static const int Lanes = 8;
+    __attribute__((target("avx2"))) static __m256i splat(const void *key) { float k; memcpy(&k, key, 4); return _mm256_castps_si256(_mm256_set1_ps(k)); }
+    __attribute__((target("avx2"))) static __m256i equal(const void *p, __m256i key) { return _mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps((const float *)p), _mm256_castsi256_ps(key), _CMP_EQ_OQ)); }
+    __attribute__((target("avx2"))) static unsigned mask(__m256i eq) { return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq)); }
+    __attribute__((target("avx2"))) static __m256i tally(__m256i total, __m256i eq) { return _mm256_sub_epi32(total, eq); }
+    template <bool Signed>
+    __attribute__((target("avx2"))) static __m256i descending(const void *p)
+    {
+        __m256 current = _mm256_loadu_ps((const float *)p);
+        __m256 next = _mm256_loadu_ps((const float *)p + 1);
+        return _mm256_castps_si256(_mm256_cmp_ps(next, current, _CMP_LT_OQ));
+    }
+};
+
+template <>
+struct CircularDynamicArrayAvx2Lanes<8, true>
+{
+    static const int Lanes = 4;
+    __attribute__((target("avx2"))) static __m256i splat(const void *key) { double k; memcpy(&k, key, 8); return _mm256_castpd_si256(_mm256_set1_pd(k)); }
+    __attribute__((target("avx2"))) static __m256i equal(const void *p, __m256i key) { return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_loadu_pd((const double *)p), _mm256_castsi256_pd(key), _CMP_EQ_OQ)); }
+    __attribute__((target("avx2"))) static unsigned mask(__m256i eq) { return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(eq)); }
+    __attribute__((target("avx2"))) static __m256i tally(__m256i total, __m256i eq) { return _mm256_sub_epi64(total, eq); }
+    template <bool Signed>
+    __attribute__((target("avx2"))) static __m256i descending(const void *p)
+    {
+        __m256d current = _mm256_loadu_pd((const double *)p);
+        __m256d next = _mm256_loadu_pd((const double *)p + 1);
+        return _mm256_castpd_si256(_mm256_cmp_pd(next, current, _CMP_LT_OQ));
+    }
+};
+
+template <>
+struct CircularDynamicArraySse2Lanes<4, false>
+{
+    static const int Lanes = 4;
+    static __m128i splat(const void *key) { int k; memcpy(&k, key, 4); return _mm_set1_epi32(k); }
+    static __m128i equal(const void *p, __m128i key) { return _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)p), key); }
+    static unsigned mask(__m128i eq) { return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq)); }
+    static __m128i tally(__m128i total, __m128i eq) { return _mm_sub_epi32(total, eq); }
+    template <bool Signed>
+    static __m128i descending(const void *p)
+    {
+        __m128i flip = _mm_set1_epi32(Signed ? 0 : (int)0x80000000u);
+        __m128i current = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p), flip);
+        __m128i next = _mm_xor_si128(_mm_loadu_si128((const __m128i *)((const char *)p + 4)), flip);
+        return _mm_cmpgt_epi32(current, next);
+    }
+};
+
+template <>
+struct CircularDynamicArraySse2Lanes<8, false>
+{
+    static const int Lanes = 2;
+    static __m128i splat(const void *key) { long long k; memcpy(&k, key, 8); return _mm_set1_epi64x(k); }
+    //sse2 has no 64 bit compare, both 32 bit halves have to match
+    static __m128i equal(const void *p, __m128i key)
+    {
+        __m128i halves = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)p), key);
+        return _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    static unsigned mask(__m128i eq) { return (unsigned)_mm_movemask_pd(_mm_castsi128_pd(eq)); }
+    static __m128i tally(__m128i total, __m128i eq) { return _mm_sub_epi64(total, eq); }
+    //no 64 bit compare in sse2 either, the two lanes are compared one at a time
+    template <bool Signed>
+    static __m128i descending(const void *p)
+    {
+        typedef typename std::conditional<Signed, long long, unsigned long long>::type Lane;
+        Lane lanes[3];
+        memcpy(lanes, p, sizeof(lanes));
+        return _mm_set_epi64x(lanes[2] < lanes[1] ? -1 : 0, lanes[1] < lanes[0] ? -1 : 0);
+    }
+};
+
+template <>
+struct CircularDynamicArraySse2Lanes<4, true>
+{
+    static const int Lanes = 4;
+    static __m128i splat(const void *key) { float k; memcpy(&k, key, 4); return _mm_castps_si128(_mm_set1_ps(k)); }
+    static __m128i equal(const void *p, __m128i key) { return _mm_castps_si128(_mm_cmpeq_ps(_mm_loadu_ps((const float *)p), _mm_castsi128_ps(key))); }
+    static unsigned mask(__m128i eq) { return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq)); }
+    static __m128i tally(__m128i total, __m128i eq) { return _mm_sub_epi32(total, eq); }
+    template <bool Signed>
+    static __m128i descending(const void *p)
+    {
+        return _mm_castps_si128(_mm_cmplt_ps(_mm_loadu_ps((const float *)p + 1), _mm_loadu_ps((const float *)p)));
+    }
+};
+
+template <>
+struct CircularDynamicArraySse2Lanes<8, true>
+{
+    static const int Lanes = 2;
+    static __m128i splat(const void *key) { double k; memcpy(&k, key, 8); return _mm_castpd_si128(_mm_set1_pd(k)); }
+    static __m128i equal(const void *p, __m128i key) { return _mm_castpd_si128(_mm_cmpeq_pd(_mm_loadu_pd((const double *)p), _mm_castsi128_pd(key))); }
+    static unsigned mask(__m128i eq) { return (unsigned)_mm_movemask_pd(_mm_castsi128_pd(eq)); }
+    static __m128i tally(__m128i total, __m128i eq) { return _mm_sub_epi64(total, eq); }
+    template <bool Signed>
+    static __m128i descending(const void *p)
+    {
+        return _mm_castpd_si128(_mm_cmplt_pd(_mm_loadu_pd((const double *)p + 1), _mm_loadu_pd((const double *)p)));
+    }
+};
+
+//4 and 8 byte integers and floats are compared 4 vectors at a time, avx2 when the cpu has it (checked at run time)
+//and sse2 otherwise, which every x86-64 cpu has. the kernels only do whole blocks, the tail is left to the plain loop.
+template <typename T>
+struct CircularDynamicArrayScan<T, true>
+{
+    typedef CircularDynamicArrayAvx2Lanes<(int)sizeof(T), std::is_floating_point<T>::value> Avx2;
+    typedef CircularDynamicArraySse2Lanes<(int)sizeof(T), std::is_floating_point<T>::value> Sse2;
+
+    static int find(const T *run, int length, const T &key)
+    {
+        int scanned;
+        int found = __builtin_cpu_supports("avx2") ? findAvx2(run, length, key, scanned) : findSse2(run, length, key, scanned);
+        if (found >= 0)
+        {
+            return found;
+        }
+        found = CircularDynamicArrayScan<T, false>::find(run + scanned, length - scanned, key);
+        return found >= 0 ? scanned + found : -1;
+    }
+
+    static int count(const T *run, int length, const T &key)
+    {
+        int scanned;
+        int matches = __builtin_cpu_supports("avx2") ? countAvx2(run, length, key, scanned) : countSse2(run, length, key, scanned);
+        return matches + CircularDynamicArrayScan<T, false>::count(run + scanned, length - scanned, key);
+    }
+
+    static bool sorted(const T *run, int length)
+    {
+        int scanned;
+        bool inOrder = __builtin_cpu_supports("avx2") ? sortedAvx2(run, length, scanned) : sortedSse2(run, length, scanned);
+        return inOrder && CircularDynamicArrayScan<T, false>::sorted(run + scanned, length - scanned);
+    }
+
+    __attribute__((target("avx2"))) static int findAvx2(const T *run, int length, const T &key, int &scanned)
+    {
+        const int lanes = Avx2::Lanes;
+        __m256i k = Avx2::splat(&key);
+        int i = 0;
+        for (; i + 4 * lanes <= length; i += 4 * lanes)
+        {
+            __m256i e0 = Avx2::equal(run + i, k);
+            __m256i e1 = Avx2::equal(run + i + lanes, k);
+            __m256i e2 = Avx2::equal(run + i + 2 * lanes, k);
+            __m256i e3 = Avx2::equal(run + i + 3 * lanes, k);
+            __m256i any = _mm256_or_si256(_mm256_or_si256(e0, e1), _mm256_or_si256(e2, e3));
+            if (!_mm256_testz_si256(any, any))
+            {
+                unsigned bits = Avx2::mask(e0) | Avx2::mask(e1) << lanes | Avx2::mask(e2) << 2 * lanes | Avx2::mask(e3) << 3 * lanes;
+                return i + __builtin_ctz(bits);
+            }
+        }
+        scanned = i;
+        return -1;
+    }
+
+    __attribute__((target("avx2"))) static int countAvx2(const T *run, int length, const T &key, int &scanned)
+    {
+        const int lanes = Avx2::Lanes;
+        __m256i k = Avx2::splat(&key);
+        __m256i totals = _mm256_setzero_si256();
+        int i = 0;
+        for (; i + 4 * lanes <= length; i += 4 * lanes)
+        {
+            totals = Avx2::tally(totals, Avx2::equal(run + i, k));
+            totals = Avx2::tally(totals, Avx2::equal(run + i + lanes, k));
+            totals = Avx2::tally(totals, Avx2::equal(run + i + 2 * lanes, k));
+            totals = Avx2::tally(totals, Avx2::equal(run + i + 3 * lanes, k));
+        }
+        scanned = i;
+        return sumLanes(&totals, sizeof(totals));
+    }
+
+    //checks every pair run[i], run[i + 1] for i < scanned, 4 vectors of pairs at a time
+    __attribute__((target("avx2"))) static bool sortedAvx2(const T *run, int length, int &scanned)
+    {
+        const int lanes = Avx2::Lanes;
+        const bool isSigned = std::is_signed<T>::value;
+        int i = 0;
+        for (; i + 4 * lanes + 1 <= length; i += 4 * lanes)
+        {
+            __m256i d0 = Avx2::template descending<isSigned>(run + i);
+            __m256i d1 = Avx2::template descending<isSigned>(run + i + lanes);
+            __m256i d2 = Avx2::template descending<isSigned>(run + i + 2 * lanes);
+            __m256i d3 = Avx2::template descending<isSigned>(run + i + 3 * lanes);
+            __m256i any = _mm256_or_si256(_mm256_or_si256(d0, d1), _mm256_or_si256(d2, d3));
+            if (!_mm256_testz_si256(any, any))
+            {
+                return false;
+            }
+        }
+        scanned = i;
+        return true;
+    }
+
+    static int findSse2(const T *run, int length, const T &key, int &scanned)
+    {
+        const int lanes = Sse2::Lanes;
+        __m128i k = Sse2::splat(&key);
+        int i = 0;
+        for (; i + 4 * lanes <= length; i += 4 * lanes)
+        {
+            __m128i e0 = Sse2::equal(run + i, k);
+            __m128i e1 = Sse2::equal(run + i + lanes, k);
+            __m128i e2 = Sse2::equal(run + i + 2 * lanes, k);
+            __m128i e3 = Sse2::equal(run + i + 3 * lanes, k);
+            __m128i any = _mm_or_si128(_mm_or_si128(e0, e1), _mm_or_si128(e2, e3));
+            if (_mm_movemask_epi8(any))
+            {
+                unsigned bits = Sse2::mask(e0) | Sse2::mask(e1) << lanes | Sse2::mask(e2) << 2 * lanes | Sse2::mask(e3) << 3 * lanes;
+                return i + __builtin_ctz(bits);
+            }
+        }
+        scanned = i;
+        return -1;
+    }
+
+    static int countSse2(const T *run, int length, const T &key, int &scanned)
+    {
+        const int lanes = Sse2::Lanes;
+        __m128i k = Sse2::splat(&key);
+        __m128i totals = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 4 * lanes <= length; i += 4 * lanes)
+        {
+            totals = Sse2::tally(totals, Sse2::equal(run + i, k));
+            totals = Sse2::tally(totals, Sse2::equal(run + i + lanes, k));
+            totals = Sse2::tally(totals, Sse2::equal(run + i + 2 * lanes, k));
+            totals = Sse2::tally(totals, Sse2::equal(run + i + 3 * lanes, k));
+        }
+        scanned = i;
+        return sumLanes(&totals, sizeof(totals));
+    }
+
+    static bool sortedSse2(const T *run, int length, int &scanned)
+    {
+        const int lanes = Sse2::Lanes;
+        const bool isSigned = std::is_signed<T>::value;
+        int i = 0;
+        for (; i + 4 * lanes + 1 <= length; i += 4 * lanes)
+        {
+            __m128i d0 = Sse2::template descending<isSigned>(run + i);
+            __m128i d1 = Sse2::template descending<isSigned>(run + i + lanes);
+            __m128i d2 = Sse2::template descending<isSigned>(run + i + 2 * lanes);
+            __m128i d3 = Sse2::template descending<isSigned>(run + i + 3 * lanes);
+            if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(d0, d1), _mm_or_si128(d2, d3))))
+            {
+                return false;
+            }
+        }
+        scanned = i;
+        return true;
+    }
+
+    //adds up the per lane counts, which are as wide as T
+    static int sumLanes(const void *totals, int bytes)
+    {
+        long long sum = 0;
+        for (int offset = 0; offset < bytes; offset += (int)sizeof(T))
+        {
+            if (sizeof(T) == 4)
+            {
+                int lane;
+                memcpy(&lane, (const char *)totals + offset, 4);
+                sum += lane;
+            }
+            else
+            {
+                long long lane;
+                memcpy(&lane, (const char *)totals + offset, 8);
+                sum += lane;
+            }
+        }
+        return (int)sum;
+    }
+};
+#else
+//no vector scans without x86 and gcc or clang builtins, everything uses the plain loops
+template <typename T>
+struct CircularDynamicArrayScan<T, true> : CircularDynamicArrayScan<T, false>
+{
+};
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+//the mappings behind StorageMode::Mirrored. the buffer is a memfd mapped twice, back to back, so byte i
+//and byte i + bytes are the same memory. every function returns nullptr when the kernel says no.
+struct CircularDynamicArrayMirror
+{
+    //the smallest multiple of the page size that holds bytes and is also a whole number of elements
+    static size_t roundBytes(size_t bytes, size_t elementSize)
+    {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t unit = page;
+        while (unit % elementSize != 0)
+        {
+            unit += page;
+        }
+        return (bytes + unit - 1) / unit * unit;
+    }
+
+    //reserves 2 * bytes of address space and maps file into both halves
+    static char *mapTwice(size_t bytes, int file)
+    {
+        void *reserved = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        char *base = static_cast<char *>(reserved);
+        if (mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file, 0) == MAP_FAILED ||
+            mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file, 0) == MAP_FAILED)
+        {
+            munmap(reserved, 2 * bytes);
+            return nullptr;
+        }
+        return base;
+    }
+
+    static char *map(size_t bytes, int &file)
+    {
+        file = memfd_create("CircularDynamicArray", MFD_CLOEXEC);
+        if (file < 0)
+        {
+            return nullptr;
+        }
+        char *base = ftruncate(file, (off_t)bytes) == 0 ? mapTwice(bytes, file) : nullptr;
+        if (base == nullptr)
+        {
+            close(file);
+            file = -1;
+        }
+        return base;
+    }
+
+    //grows the file and maps it again. the pages already in the file keep their contents, nothing is copied.
+    //the old mapping is only dropped once the new one is in place.
+    static char *remap(char *base, size_t bytes, size_t newBytes, int file)
+    {
+        if (ftruncate(file, (off_t)newBytes) != 0)
+        {
+            return nullptr;
+        }
+        char *grown = mapTwice(newBytes, file);
+        if (grown != nullptr)
+        {
+            munmap(base, 2 * bytes);
+        }
+        return grown;
+    }
+
+    static void unmap(char *base, size_t bytes, int file)
+    {
+        munmap(base, 2 * bytes);
+        close(file);
+    }
+};
+#else
+//no memfd, setStorageMode(Mirrored) reports that and keeps the contiguous buffer
+struct CircularDynamicArrayMirror
+{
+    static size_t roundBytes(size_t bytes, size_t)
+    {
+        return bytes;
+    }
+
+    static char *map(size_t, int &file)
+    {
+        file = -1;
+        return nullptr;
+    }
+
+    static char *remap(char *, size_t, size_t, int)
+    {
+        return nullptr;
+    }
+
+    static void unmap(char *, size_t, int)
+    {
+    }
+};
+#endif
+
+//room for Slots elements inside the array object itself, so an array that stays that short never allocates.
+//only one buffer at a time can live here, take hands out nullptr while it is in use.
+template <typename T, int Slots>
+struct CircularDynamicArrayInlineStorage
+{
+    alignas(T) unsigned char bytes[Slots * sizeof(T)];
+    bool taken = false;
+
+    T *take(int capacity)
+    {
+        if (taken || capacity <= 0 || capacity > Slots)
+        {
+            return nullptr;
+        }
+        taken = true;
+        return reinterpret_cast<T *>(bytes);
+    }
+
+    bool holds(const T *buffer) const
+    {
+        return taken && buffer == reinterpret_cast<const T *>(bytes);
+    }
+
+    //false if buffer isn't the inline one
+    bool giveBack(const T *buffer)
+    {
+        if (buffer != reinterpret_cast<const T *>(bytes))
+        {
+            return false;
+        }
+        taken = false;
+        return true;
+    }
+};
+
 template <typename T>
+struct CircularDynamicArrayInlineStorage<T, 0>
+{
+    T *take(int) { return nullptr; }
+    bool holds(const T *) const { return false; }
+    bool giveBack(const T *) { return false; }
+};
+
+template <typename T, typename Allocator = std::allocator<T>>
+class CircularDynamicArraySearchIndex;
+
+template <typename T, int InlineSlots = 0, typename Allocator = std::allocator<T>, AccessPolicy Access = AccessPolicy::Report>
 class CircularDynamicArray
 {
 public:
+    typedef CircularDynamicArrayIterator<CircularDynamicArray, T> iterator;
+    typedef CircularDynamicArrayIterator<const CircularDynamicArray, const T> const_iterator;
+
+    //the elements as (at most) two contiguous pieces of memory, first holds elements 0 to firstLength - 1
+    //and second holds the rest. only valid until the array is next modified.
+    struct Spans
+    {
+        T *first;
+        int firstLength;
+        T *second;
+        int secondLength;
+    };
+
     CircularDynamicArray();
-    CircularDynamicArray(int s);
+    explicit CircularDynamicArray(const Allocator &allocator);
+    CircularDynamicArray(int s, const Allocator &allocator = Allocator());
     CircularDynamicArray(const CircularDynamicArray &other);
     CircularDynamicArray& operator=(const CircularDynamicArray &other);
     ~CircularDynamicArray();
     T &operator[](int index);
-    void addEnd(T element);
-    void addFront(T element);
+    const T &operator[](int index) const;
+    void addEnd(const T &element);
+    void addEnd(T &&element);
+    void addFront(const T &element);
+    void addFront(T &&element);
+    template <typename... Args>
+    const T &emplaceEnd(Args &&...args);
+    template <typename... Args>
+    const T &emplaceFront(Args &&...args);
     void delEnd();
     void delFront();
+    void addEndRange(const T *elements, int n);
+    void addFrontRange(const T *elements, int n);
+    void delEnd(int n);
+    void delFront(int n);
     int length() const;
     int capacity() const;
+    Allocator allocator() const;
+    void setCapacityPolicy(CapacityPolicy policy);
+    CapacityPolicy capacityPolicy() const;
+    void setStorageMode(StorageMode mode);
+    StorageMode storageMode() const;
+    void setResizeMode(ResizeMode mode);
+    ResizeMode resizeMode() const;
+    void setGrowthPolicy(double growthFactor, double shrinkThreshold);
+    double growthFactor() const;
+    double shrinkThreshold() const;
+    void reserve(int n);
+    void shrinkToFit();
+    void setFixedCapacity(int capacity);
+    int fixedCapacity() const;
+    long long droppedCount() const;
     void clear();
     T QuickSelect(int k);
     T WCSelect(int k);
+    CircularDynamicArray multiSelect(const int *ks, int m);
+    CircularDynamicArray quantiles(const double *qs, int m);
+    CircularDynamicArray quantiles(std::initializer_list<double> qs);
     void stableSort();
+    void parallelStableSort(int threads = 0);
     void radixSort(int i);
+    template <typename KeyFunction>
+    void radixSortBy(KeyFunction key);
+    void parallelRadixSort(int i, int threads = 0);
+    template <typename KeyFunction>
+    void parallelRadixSortBy(KeyFunction key, int threads = 0);
+    bool isSorted() const;
     int linearSearch(T element);
+    int count(T element) const;
+    int findAll(T element, CircularDynamicArray<int> &out) const;
     int binSearch(T element);
+    int lowerBound(T element) const;
+    void binSearchBatch(const T *keys, int n, int *out) const;
+    CircularDynamicArraySearchIndex<T, Allocator> buildSearchIndex() const;
     void print();
     T &getElement(int index);
+    const T &getElement(int index) const;
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    Spans asSpans();
+    int contiguousRun(int index, const T *&run) const;
 private:
+    //non-const iterators write through elementAt, begin and end have already cleared m_sorted
+    template <typename Container, typename Element>
+    friend class CircularDynamicArrayIterator;
+
     //private variables
     T *array;
     int frontIndex = 0;
@@ -43,672 +756,3273 @@ private:
     int m_length;   //same as count, num of elements in array
     int m_capacity; //possible amount of elements in array
     T errorElem;
+    CapacityPolicy m_policy = CapacityPolicy::Exact;
+    int m_wrapMask = 0; //capacity - 1 when the capacity is a power of two, otherwise 0
+    double m_growthFactor = 2.0;    //capacity is multiplied by this when the array is full
+    double m_shrinkThreshold = .25; //capacity is halved when the length drops below this fraction of it, 0 never shrinks
+    int m_minCapacity = 0;          //set by reserve, the array never shrinks below it on its own
+    int m_fixedCapacity = 0;        //set by setFixedCapacity, 0 when the array is allowed to grow
+    long long m_dropped = 0;        //elements a fixed capacity array has dropped to make room
+
+    //segmented storage, array is unused while m_storage is Segmented
+    StorageMode m_storage = StorageMode::Contiguous;
+    static const int BlockShift = 8;
+    static const int BlockSize = 1 << BlockShift;
+    T **m_blocks = nullptr;     //circular map of blocks, its capacity is always a power of two
+    int m_blockMapCapacity = 0;
+    int m_firstBlock = 0;       //map slot of the block holding the front element
+    int m_blockCount = 0;       //blocks currently in use
+    int m_blockOffset = 0;      //offset of the front element inside the first block
+    T *m_spareBlock = nullptr;  //last freed block, kept so a queue sitting on a block boundary doesn't hit the allocator
+
+    //memfd behind array while m_storage is Mirrored, array then points at the first of its two mappings
+    int m_mirrorFile = -1;
+
+    //incremental resizing. while m_oldArray is set, the elements at logical indices
+    //[m_pendingStart, m_pendingStart + m_pendingCount) are still in the old buffer, starting at m_oldFront.
+    //every other element is already in array, and the slots of the pending ones are kept free for them.
+    ResizeMode m_resizeMode = ResizeMode::Immediate;
+    int m_migrationStep = 4;    //elements moved per add/delete, set by beginIncrementalResize so it finishes before the next resize
+    T *m_oldArray = nullptr;
+    int m_oldCapacity = 0;
+    int m_oldFront = 0;
+    int m_pendingStart = 0;
+    int m_pendingCount = 0;
+
+    //true only when the elements are known to be in order. adds check their neighbour, sorting sets it and
+    //handing out a writable element (operator[], getElement, iterators, spans) clears it. the const accessors
+    //leave it alone, elementAt is the writable one the algorithms in here use.
+    mutable bool m_sorted = true;
+
+    //every buffer, scratch space, block map, worker thread and search index comes from here
+    Allocator m_allocator;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<T *> BlockMapAllocator;
+
+    //the first buffer of at most InlineSlots elements is kept in here instead of on the heap
+    CircularDynamicArrayInlineStorage<T, InlineSlots> m_inline;
 
     //accessor functions
+    static bool rejectAccess(bool invalid, const char *what);
+    bool rejectUnsorted(const char *what) const;
     int correctIndex(int i);
+    int wrapIndex(int i) const;
+    int firstSegmentLength() const;
+    T &blockElement(int index) const;
+    T &elementAt(int index);
+    const T &elementAt(int index) const;
+    int oldWrapIndex(int i) const;
+    void updateWrapMask();
+    static int roundUpPowerOfTwo(int n);
 
     //size change functions
     void growArray();
     void shrinkArray();
+    bool shouldShrink() const;
+    int grownCapacity(int capacity) const;
+    int shrunkCapacity() const;
+    int fittedCapacity(int length) const;
+    void resizeBuffer(int newCapacity);
+    void relocateInto(T *destination);
+    void dropFront(int count);
+    void dropEnd(int count);
+    void copyFrom(const CircularDynamicArray &other);
+    void adoptAllocator(const CircularDynamicArray &other, std::true_type);
+    void adoptAllocator(const CircularDynamicArray &other, std::false_type);
+    void destroyElements();
+    static void copyConstruct(T *destination, const T *source, int count);
+    void trackEnd(const T &element);
+    void trackFront(const T &element);
+    static void moveConstruct(T *destination, T *source, int count);
+    T *allocateBuffer(int capacity);
+    void releaseBuffer(T *buffer, int capacity);
+    T **allocateBlockMap(int capacity);
+    void releaseBlockMap(T **map, int capacity);
+    template <typename U>
+    U *allocateScratch(int count) const;
+    template <typename U>
+    void releaseScratch(U *scratch, int count) const;
+    T *takeStorage(int capacity);
+    void giveBackStorage(T *buffer, int capacity);
+
+    //incremental resize functions
+    void beginIncrementalResize(int newCapacity);
+    void migrateElements(int count);
+    void finishMigration();
+
+    //segmented storage functions
+    T *blockSlotForEnd();
+    T *blockSlotForFront();
+    void releaseFrontBlock();
+    void releaseEmptyEndBlocks();
+    void growBlockMap();
+    T *takeBlock();
+    void giveBackBlock(T *block);
+    void releaseBlocks();
     void clearCompletely();
 
-    //quickselect recursive
-    T qsRecursive(int left, int right, int k);
-
-    //wcselect recursive
+    //mirrored storage functions
+    void enterMirror();
+    void leaveMirror();
+    void releaseMirror();
+    void resizeMirror(int newCapacity);
+
+    //quickselect, iterative with a worst case select fallback
+    static const int NintherCutoff = 128;
+    static const int FloydRivestCutoff = 600;
+    T introSelect(int left, int right, int k);
+    int floydRivestPivot(int left, int right, int k);
+    int medianOfThree(int a, int b, int c);
+    void multiSelectRecursive(int left, int right, const int *positions, int count);
+
+    //wcselect, recursive only for the median of medians
     T wcRecursive(int left, int right, int k);
+    void sortFive(int first);
+    void compareExchange(T &a, T &b);
 
-    //mergesort recursive
+    //bottom up mergesort, runs this short are insertion sorted first
+    static const int MergeSortRun = 32;
     void mergeSort(int left, int right);
-    void merge(int left, int middle, int right);
-    //next two are overloads to sort ANY array. used to sort medians in wcSelect
+    //overload to sort ANY array. used on the linearized array
     void mergeSort(T* array, int left, int right);
-    void merge(T* array, int left, int middle, int right);
+    static void sortRuns(T *array, int length, T *scratch);
+    static void mergeRuns(T *left, int leftLength, T *right, int rightLength, T *destination);
+    static int coRank(int k, const T *left, int leftLength, const T *right, int rightLength);
+    static void insertionSort(T *array, int length);
 
     //sorting and selecting helper functions
-    int partition(int left, int right);
-    int partition(int left, int right, T partitionElement);
+    void partition(int left, int right, const T &partitionElement, int &equalStart, int &equalEnd);
     void swap(T &a, T &b);
 
-    //binarysearch recursive
-    int binSearchRecursive(int left, int right, T key);
-
-    //countingSort for radix
-    void bitCountingSort(int bit);
+    //binary search helpers
+    static const int BatchSearchLanes = 16;
+    const T *probeAddress(int index) const;
+    static void prefetch(const T *element);
+
+    //radix sort on any integral key, 8 bits per pass
+    static const int RadixDigitBits = 8;
+    static const int RadixBuckets = 1 << RadixDigitBits;
+    static const int ParallelSortMinimum = 1 << 16; //fewest elements worth handing to one more thread
+    template <typename KeyFunction>
+    void lsdRadixSort(KeyFunction key, int bits);
+    template <typename KeyFunction>
+    void parallelLsdRadixSort(KeyFunction key, int bits, int threads);
+    template <typename UnsignedKey, typename Key>
+    static void radixKeyMasks(int &bits, UnsignedKey &flip, UnsignedKey &mask);
+    static int sortThreadCount(int threads, int length);
+    template <typename Function>
+    void runParallel(int threads, Function work) const;
+
+    //contiguous access for the sorts
+    T *linearize();
+    void releaseLinear(T *data);
 };
 
 #pragma region Constuctors
 
-//default constructor, should default to size 2
-template <typename T>
-CircularDynamicArray<T>::CircularDynamicArray()
+//default constructor, should default to size 2 (or all the inline slots, they are there anyway)
+//the buffer is raw storage, only the m_length slots starting at frontIndex hold constructed elements
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access>::CircularDynamicArray() : CircularDynamicArray(Allocator())
 {
-    array = new T[2];
+}
+
+//an empty array that takes all of its memory from allocator
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access>::CircularDynamicArray(const Allocator &allocator) : m_allocator(allocator)
+{
+    m_capacity = InlineSlots > 2 ? InlineSlots : 2;
+    array = takeStorage(m_capacity);
     m_length = 0;
-    m_capacity = 2;
 }
 
 //
-template <typename T>
-CircularDynamicArray<T>::CircularDynamicArray(int s)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access>::CircularDynamicArray(int s, const Allocator &allocator) : m_allocator(allocator)
 {
-    array = new T[s];
+    m_capacity = s > InlineSlots ? s : InlineSlots;
+    array = takeStorage(m_capacity);
     m_length = s;
-    m_capacity = s;
+    for (int i = 0; i < s; i++)
+    {
+        ::new (static_cast<void *>(array + i)) T();
+    }
+    //the inline slots can leave room after the s elements
+    endIndex = wrapIndex(m_length);
 }
 
-template <typename T>
-CircularDynamicArray<T>::CircularDynamicArray(const CircularDynamicArray<T> &other)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access>::CircularDynamicArray(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &other)
+    : m_allocator(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.m_allocator))
 {
-    array = new T[other.capacity()];
-    m_length = other.length();
-    m_capacity = other.capacity();
-    for(int i = 0; i < m_length; i++){
-        array[i] = other.array[(other.frontIndex + i) % other.m_capacity];
-        endIndex++;
-    }
+    array = nullptr;
+    m_capacity = 0;
+    copyFrom(other);
 }
 
-template <typename T>
-CircularDynamicArray<T>& CircularDynamicArray<T>::operator= (const CircularDynamicArray<T> &other){
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access>& CircularDynamicArray<T, InlineSlots, Allocator, Access>::operator= (const CircularDynamicArray<T, InlineSlots, Allocator, Access> &other){
     if(this == &other){
         return *this;
     }
 
-    delete[] array;
-    array = new T[other.capacity()];
-    m_length = other.length();
-    m_capacity = other.capacity();
-    frontIndex = 0;
-    endIndex = 0;
-    for(int i = 0; i < m_length; i++){
-        array[i] = other.array[(other.frontIndex + i) % other.m_capacity];
-        endIndex++;
+    destroyElements();
+    releaseBlocks();
+    if (m_storage == StorageMode::Mirrored)
+    {
+        releaseMirror();
     }
+    adoptAllocator(other, typename std::allocator_traits<Allocator>::propagate_on_container_copy_assignment());
+    copyFrom(other);
 	return *this;
 }
 
 //destructor
-template <typename T>
-CircularDynamicArray<T>::~CircularDynamicArray()
-{
-    delete[] array;
-}
-
-#pragma endregion Constructors
-
-#pragma region ArrayAccess
-
-//returns a reference to an object in the array
-template <typename T>
-T &CircularDynamicArray<T>::operator[](int index)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access>::~CircularDynamicArray()
 {
-    if(index < 0 || index >= m_length){
-        cout << endl << "Error: Out of bounds index." << endl << endl;
-        return errorElem;
+    destroyElements();
+    releaseBlocks();
+    if (m_storage == StorageMode::Mirrored)
+    {
+        releaseMirror();
     }
-    return array[(frontIndex + index) % m_capacity];
+    giveBackStorage(array, m_capacity);
 }
 
-template <typename T>
-int CircularDynamicArray<T>::correctIndex(int i)
+//assignment takes other's allocator when the allocator asks for it. the buffer goes back to the allocator
+//it came from first, copyFrom then allocates a new one.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::adoptAllocator(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &other, std::true_type)
 {
-    return ((i + m_capacity) % m_capacity);
+    if (m_allocator != other.m_allocator)
+    {
+        giveBackStorage(array, m_capacity);
+        array = nullptr;
+        m_capacity = 0;
+        m_allocator = other.m_allocator;
+    }
 }
 
-template <typename T>
-T &CircularDynamicArray<T>::getElement(int index)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::adoptAllocator(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &, std::false_type)
 {
-    return array[(index + frontIndex) % m_capacity];
 }
 
-#pragma endregion ArrayAccess
-
-#pragma region AdjustSize
-
-template <typename T>
-void CircularDynamicArray<T>::growArray()
+//copy constructs the elements of other into this (already empty, not mirrored) array, using the same storage mode
+//as other. the buffer is reused when it already has the right capacity. a mirrored other is copied into a plain
+//buffer first and then mapped.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::copyFrom(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &other)
 {
-    if(m_capacity == 0){
-        m_capacity = 1;
-    }
-    int newCapacity = m_capacity * 2;
-    T *newArray = new T[newCapacity];
-    for (int i = 0; i < m_length; i++)
+    int newCapacity = other.m_storage == StorageMode::Segmented ? 0 : other.m_capacity;
+    if (m_capacity != newCapacity)
     {
-        newArray[i] = getElement(i);
+        giveBackStorage(array, m_capacity);
+        array = takeStorage(newCapacity);
+        m_capacity = newCapacity;
     }
-    array = newArray;
-    m_capacity = newCapacity;
+    m_policy = other.m_policy;
+    m_storage = other.m_storage == StorageMode::Segmented ? StorageMode::Segmented : StorageMode::Contiguous;
+    m_resizeMode = other.m_resizeMode;
+    m_growthFactor = other.m_growthFactor;
+    m_shrinkThreshold = other.m_shrinkThreshold;
+    m_minCapacity = other.m_minCapacity;
+    m_fixedCapacity = other.m_fixedCapacity;
+    m_dropped = other.m_dropped;
+    m_sorted = other.m_sorted;
+    updateWrapMask();
     frontIndex = 0;
-    endIndex = m_length; //maybe needs to be m_length+1 or -1;
-}
+    m_length = 0;
 
-template <typename T>
-void CircularDynamicArray<T>::shrinkArray()
-{
-    int newCapacity = m_capacity / 2;
-    T *newArray = new T[newCapacity];
-    for (int i = 0; i < m_length; i++)
+    for (int i = 0; i < other.m_length;)
     {
-        newArray[i] = array[(frontIndex + i) % m_capacity];
-    }
+        const T *run;
+        int count = other.contiguousRun(i, run);
+        if (m_storage == StorageMode::Segmented)
+        {
+            for (int j = 0; j < count; j++)
+            {
+                ::new (static_cast<void *>(blockSlotForEnd())) T(run[j]);
+                m_length++;
+            }
+        }
+        else
+        {
+            copyConstruct(array + i, run, count);
+            m_length += count;
+        }
+        i += count;
+    }
+    endIndex = wrapIndex(m_length);
+    if (other.m_storage == StorageMode::Mirrored)
+    {
+        setStorageMode(StorageMode::Mirrored);
+    }
+}
+
+#pragma endregion Constructors
+
+#pragma region ArrayAccess
+
+//returns a reference to an object in the array
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::operator[](int index)
+{
+    if(rejectAccess(index < 0 || index >= m_length, "CircularDynamicArray index out of bounds")){
+        cout << endl << "Error: Out of bounds index." << endl << endl;
+        return errorElem;
+    }
+    //the element could be written through the reference
+    m_sorted = false;
+    return elementAt(index);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+const T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::operator[](int index) const
+{
+    if(rejectAccess(index < 0 || index >= m_length, "CircularDynamicArray index out of bounds")){
+        cout << endl << "Error: Out of bounds index." << endl << endl;
+        return errorElem;
+    }
+    return elementAt(index);
+}
+
+//whether the caller has to refuse an access, invalid says if it is out of bounds (or otherwise can't be done). only Report refuses,
+//Throw throws instead and Assert and Unchecked let it through, so for them the check is folded away.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+bool CircularDynamicArray<T, InlineSlots, Allocator, Access>::rejectAccess(bool invalid, const char *what)
+{
+    switch (Access)
+    {
+    case AccessPolicy::Unchecked:
+        return false;
+    case AccessPolicy::Assert:
+        assert(!invalid && what);
+        return false;
+    case AccessPolicy::Throw:
+        if (invalid)
+        {
+            throw std::out_of_range(what);
+        }
+        return false;
+    default:
+        return invalid;
+    }
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::correctIndex(int i)
+{
+    return wrapIndex(i);
+}
+
+//maps a slot in [-capacity, 2 * capacity) back into the buffer without dividing.
+//every index that is built from frontIndex plus an offset lands in that range.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::wrapIndex(int i) const
+{
+    if (m_wrapMask != 0)
+    {
+        return i & m_wrapMask;
+    }
+    if (i >= m_capacity)
+    {
+        return i - m_capacity;
+    }
+    if (i < 0)
+    {
+        return i + m_capacity;
+    }
+    return i;
+}
+
+//number of elements stored between frontIndex and the physical end of the buffer.
+//the rest (m_length minus this) starts over at index 0. a mirrored buffer never ends early.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::firstSegmentLength() const
+{
+    if (m_storage == StorageMode::Mirrored)
+    {
+        return m_length;
+    }
+    int tail = m_capacity - frontIndex;
+    return m_length < tail ? m_length : tail;
+}
+
+//sets run to the address of element index and returns how many elements, starting there, sit next to each other in memory
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::contiguousRun(int index, const T *&run) const
+{
+    if (m_storage == StorageMode::Segmented)
+    {
+        int slot = m_blockOffset + index;
+        run = &blockElement(index);
+        int leftInBlock = BlockSize - (slot & (BlockSize - 1));
+        return leftInBlock < m_length - index ? leftInBlock : m_length - index;
+    }
+
+    int limit = m_length;
+    if (m_oldArray != nullptr)
+    {
+        int pending = index - m_pendingStart;
+        if (pending >= 0 && pending < m_pendingCount)
+        {
+            int slot = oldWrapIndex(m_oldFront + pending);
+            run = m_oldArray + slot;
+            int toEnd = m_oldCapacity - slot;
+            return toEnd < m_pendingCount - pending ? toEnd : m_pendingCount - pending;
+        }
+        if (index < m_pendingStart)
+        {
+            limit = m_pendingStart;
+        }
+    }
+
+    int first = firstSegmentLength();
+    if (index < first)
+    {
+        run = array + frontIndex + index;
+        return (first < limit ? first : limit) - index;
+    }
+    run = array + (index - first);
+    return limit - index;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::blockElement(int index) const
+{
+    int slot = m_blockOffset + index;
+    return m_blocks[(m_firstBlock + (slot >> BlockShift)) & (m_blockMapCapacity - 1)][slot & (BlockSize - 1)];
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::elementAt(int index)
+{
+    if (m_storage == StorageMode::Segmented)
+    {
+        return blockElement(index);
+    }
+    if (m_storage == StorageMode::Mirrored)
+    {
+        //the second mapping carries on where the buffer ends, nothing to wrap
+        return array[frontIndex + index];
+    }
+    if (m_oldArray != nullptr && index >= m_pendingStart && index < m_pendingStart + m_pendingCount)
+    {
+        return m_oldArray[oldWrapIndex(m_oldFront + index - m_pendingStart)];
+    }
+    return array[wrapIndex(index + frontIndex)];
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+const T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::elementAt(int index) const
+{
+    return const_cast<CircularDynamicArray<T, InlineSlots, Allocator, Access> *>(this)->elementAt(index);
+}
+
+//no bounds check. the element could be written through the reference, so like operator[] it clears the sortedness flag
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::getElement(int index)
+{
+    m_sorted = false;
+    return elementAt(index);
+}
+
+//read only, the sortedness flag stays as it is
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+const T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::getElement(int index) const
+{
+    return elementAt(index);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+typename CircularDynamicArray<T, InlineSlots, Allocator, Access>::iterator CircularDynamicArray<T, InlineSlots, Allocator, Access>::begin()
+{
+    m_sorted = false;
+    return iterator(this, 0);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+typename CircularDynamicArray<T, InlineSlots, Allocator, Access>::iterator CircularDynamicArray<T, InlineSlots, Allocator, Access>::end()
+{
+    m_sorted = false;
+    return iterator(this, m_length);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+typename CircularDynamicArray<T, InlineSlots, Allocator, Access>::const_iterator CircularDynamicArray<T, InlineSlots, Allocator, Access>::begin() const
+{
+    return const_iterator(this, 0);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+typename CircularDynamicArray<T, InlineSlots, Allocator, Access>::const_iterator CircularDynamicArray<T, InlineSlots, Allocator, Access>::end() const
+{
+    return const_iterator(this, m_length);
+}
+
+//the contiguous buffer as two pointers, so the data can be handed to memcpy, write() or a simd loop without copying.
+//finishes an incremental resize first. segmented storage has no two piece layout, use contiguousRun to walk it.
+//asking for its spans is misuse like an out of bounds index, Throw and Assert report it and otherwise both spans
+//come back empty without printing anything. mirrored storage always comes back as a single span.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+typename CircularDynamicArray<T, InlineSlots, Allocator, Access>::Spans CircularDynamicArray<T, InlineSlots, Allocator, Access>::asSpans()
+{
+    Spans spans = {nullptr, 0, nullptr, 0};
+    if (m_storage == StorageMode::Segmented)
+    {
+        rejectAccess(true, "CircularDynamicArray::asSpans needs contiguous storage");
+        return spans;
+    }
+
+    finishMigration();
+    m_sorted = false;
+    spans.firstLength = firstSegmentLength();
+    spans.first = array + frontIndex;
+    spans.second = array;
+    spans.secondLength = m_length - spans.firstLength;
+    return spans;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::oldWrapIndex(int i) const
+{
+    return i >= m_oldCapacity ? i - m_oldCapacity : i;
+}
+
+#pragma endregion ArrayAccess
+
+#pragma region AdjustSize
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::growArray()
+{
+    int newCapacity = grownCapacity(m_capacity);
+    if (m_resizeMode == ResizeMode::Incremental && m_storage != StorageMode::Mirrored)
+    {
+        beginIncrementalResize(newCapacity);
+        return;
+    }
+    resizeBuffer(newCapacity);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::shrinkArray()
+{
+    if (m_resizeMode == ResizeMode::Incremental && m_storage != StorageMode::Mirrored)
+    {
+        beginIncrementalResize(shrunkCapacity());
+        return;
+    }
+    resizeBuffer(shrunkCapacity());
+}
+
+//half the capacity, but never fewer slots than the inline storage has
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::shrunkCapacity() const
+{
+    return m_capacity / 2 < InlineSlots ? InlineSlots : m_capacity / 2;
+}
+
+//the capacity after one growth step from the given capacity
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::grownCapacity(int capacity) const
+{
+    int newCapacity = (int)(capacity * m_growthFactor);
+    if (newCapacity < capacity + 1)
+    {
+        newCapacity = capacity == 0 ? 2 : capacity + 1;
+    }
+    if (m_policy == CapacityPolicy::PowerOfTwo)
+    {
+        newCapacity = roundUpPowerOfTwo(newCapacity);
+    }
+    return newCapacity;
+}
+
+//the capacity the growth and shrink rules would settle on for the given length, starting from the current capacity.
+//used by the bulk functions so they only resize once. a fixed capacity array keeps its buffer.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::fittedCapacity(int length) const
+{
+    if (m_fixedCapacity != 0)
+    {
+        return m_capacity;
+    }
+    int newCapacity = m_capacity;
+    while (newCapacity < length)
+    {
+        newCapacity = grownCapacity(newCapacity);
+    }
+    while (length < newCapacity * m_shrinkThreshold && newCapacity / 2 >= m_minCapacity && newCapacity > InlineSlots)
+    {
+        newCapacity /= 2;
+    }
+    return newCapacity < InlineSlots ? InlineSlots : newCapacity;
+}
+
+//the length has to fall below the shrink threshold, and halving must not go under the reserved capacity.
+//an array already down to its inline slots, or with a fixed capacity, has nothing to give back. one with a few
+//more than that shrinks to exactly the inline slots (see shrunkCapacity).
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+bool CircularDynamicArray<T, InlineSlots, Allocator, Access>::shouldShrink() const
+{
+    return m_fixedCapacity == 0 && m_length < m_capacity * m_shrinkThreshold && m_capacity / 2 >= m_minCapacity && m_capacity > InlineSlots;
+}
+
+//moves every element into a new buffer of the given capacity, starting at index 0, and frees the old one
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::resizeBuffer(int newCapacity)
+{
+    finishMigration();
+    if (m_storage == StorageMode::Mirrored)
+    {
+        resizeMirror(newCapacity);
+        return;
+    }
+    if (newCapacity < InlineSlots)
+    {
+        //the inline slots are there anyway, a buffer that fits in them uses all of them
+        newCapacity = InlineSlots;
+    }
+    if (newCapacity == InlineSlots && m_inline.holds(array))
+    {
+        //already inline and staying there (linearize unwrapping a short array). the elements step out into
+        //scratch slots on the stack and come back in order, so this never allocates
+        CircularDynamicArrayInlineStorage<T, InlineSlots> scratch;
+        T *temporary = scratch.take(InlineSlots);
+        relocateInto(temporary);
+        moveConstruct(array, temporary, m_length);
+        m_capacity = newCapacity;
+        updateWrapMask();
+        frontIndex = 0;
+        endIndex = wrapIndex(m_length);
+        return;
+    }
+    T *newArray = takeStorage(newCapacity);
+    relocateInto(newArray);
+    giveBackStorage(array, m_capacity);
     array = newArray;
     m_capacity = newCapacity;
+    updateWrapMask();
     frontIndex = 0;
-    endIndex = m_length;
+    endIndex = wrapIndex(m_length);
 }
 
-#pragma endregion AdjustSize
+//move constructs the elements, in order, into uninitialized storage and ends the lifetime of the originals.
+//trivially copyable types are moved as the (at most) two contiguous pieces of the buffer with memcpy.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::relocateInto(T *destination)
+{
+    int first = firstSegmentLength();
+    if (std::is_trivially_copyable<T>::value)
+    {
+        if (first > 0)
+        {
+            memcpy(static_cast<void *>(destination), array + frontIndex, first * sizeof(T));
+        }
+        if (m_length > first)
+        {
+            memcpy(static_cast<void *>(destination + first), array, (m_length - first) * sizeof(T));
+        }
+        return;
+    }
 
-#pragma region AddDeleteElements
+    for (int i = 0; i < m_length; i++)
+    {
+        T &element = elementAt(i);
+        ::new (static_cast<void *>(destination + i)) T(std::move(element));
+        element.~T();
+    }
+}
 
-template <typename T>
-void CircularDynamicArray<T>::addEnd(T element)
+//copy constructs count elements into uninitialized storage, with a single memcpy when T allows it
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::copyConstruct(T *destination, const T *source, int count)
 {
-    if (m_length == m_capacity)
+    if (std::is_trivially_copyable<T>::value)
     {
-        growArray();
+        if (count > 0)
+        {
+            memcpy(static_cast<void *>(destination), source, count * sizeof(T));
+        }
+        return;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        ::new (static_cast<void *>(destination + i)) T(source[i]);
     }
+}
 
-    array[endIndex] = element;
-    endIndex = correctIndex(endIndex + 1);
-    m_length++;
+//element is about to become the last element, the array stays sorted if it isn't smaller than the current last one
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::trackEnd(const T &element)
+{
+    if (m_sorted && m_length > 0)
+    {
+        m_sorted = CircularDynamicArrayOrder<T>::inOrder(elementAt(m_length - 1), element);
+    }
 }
 
-template <typename T>
-void CircularDynamicArray<T>::addFront(T element)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::trackFront(const T &element)
 {
-    if (m_length == 0)
+    if (m_sorted && m_length > 0)
+    {
+        m_sorted = CircularDynamicArrayOrder<T>::inOrder(element, elementAt(0));
+    }
+}
+
+//moves count elements into uninitialized storage and destroys the originals
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::moveConstruct(T *destination, T *source, int count)
+{
+    if (std::is_trivially_copyable<T>::value)
     {
-        addEnd(element);
+        if (count > 0)
+        {
+            memcpy(static_cast<void *>(destination), source, count * sizeof(T));
+        }
         return;
     }
+    for (int i = 0; i < count; i++)
+    {
+        ::new (static_cast<void *>(destination + i)) T(std::move(source[i]));
+        source[i].~T();
+    }
+}
 
-    if (m_length == m_capacity)
+//destroys every element, including the ones an incremental resize has not moved yet, and drops the old buffer
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::destroyElements()
+{
+    if (!std::is_trivially_destructible<T>::value)
     {
-        growArray();
+        for (int i = 0; i < m_length; i++)
+        {
+            elementAt(i).~T();
+        }
     }
+    m_length = 0;
+    if (m_oldArray != nullptr)
+    {
+        giveBackStorage(m_oldArray, m_oldCapacity);
+        m_oldArray = nullptr;
+        m_oldCapacity = 0;
+        m_pendingCount = 0;
+    }
+}
 
-    frontIndex = correctIndex(frontIndex - 1);
-    array[frontIndex] = element;
-    m_length++;
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T *CircularDynamicArray<T, InlineSlots, Allocator, Access>::allocateBuffer(int capacity)
+{
+    if (capacity <= 0)
+    {
+        return nullptr;
+    }
+    return std::allocator_traits<Allocator>::allocate(m_allocator, capacity);
 }
 
-template <typename T>
-void CircularDynamicArray<T>::delEnd()
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseBuffer(T *buffer, int capacity)
 {
-    if (m_length == 0)
+    if (buffer != nullptr)
+    {
+        std::allocator_traits<Allocator>::deallocate(m_allocator, buffer, capacity);
+    }
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T **CircularDynamicArray<T, InlineSlots, Allocator, Access>::allocateBlockMap(int capacity)
+{
+    BlockMapAllocator mapAllocator(m_allocator);
+    return std::allocator_traits<BlockMapAllocator>::allocate(mapAllocator, capacity);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseBlockMap(T **map, int capacity)
+{
+    if (map != nullptr)
+    {
+        BlockMapAllocator mapAllocator(m_allocator);
+        std::allocator_traits<BlockMapAllocator>::deallocate(mapAllocator, map, capacity);
+    }
+}
+
+//uninitialized room for count objects of any type (indices, counters, threads), from m_allocator rebound to it
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename U>
+U *CircularDynamicArray<T, InlineSlots, Allocator, Access>::allocateScratch(int count) const
+{
+    if (count <= 0)
+    {
+        return nullptr;
+    }
+    typename std::allocator_traits<Allocator>::template rebind_alloc<U> scratchAllocator(m_allocator);
+    return std::allocator_traits<decltype(scratchAllocator)>::allocate(scratchAllocator, count);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename U>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseScratch(U *scratch, int count) const
+{
+    if (scratch != nullptr)
+    {
+        typename std::allocator_traits<Allocator>::template rebind_alloc<U> scratchAllocator(m_allocator);
+        std::allocator_traits<decltype(scratchAllocator)>::deallocate(scratchAllocator, scratch, count);
+    }
+}
+
+//buffers that hold the elements come from here, scratch space and segment blocks always use allocateBuffer
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T *CircularDynamicArray<T, InlineSlots, Allocator, Access>::takeStorage(int capacity)
+{
+    T *buffer = m_inline.take(capacity);
+    return buffer != nullptr ? buffer : allocateBuffer(capacity);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::giveBackStorage(T *buffer, int capacity)
+{
+    if (!m_inline.giveBack(buffer))
+    {
+        releaseBuffer(buffer, capacity);
+    }
+}
+
+//switching to PowerOfTwo rounds the current capacity up once, every later grow/shrink
+//doubles or halves it so it stays a power of two.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::setCapacityPolicy(CapacityPolicy policy)
+{
+    m_policy = policy;
+    if (m_storage == StorageMode::Segmented)
     {
-        cout << "Trying to delete element from an empty array! Aborting." << endl;
         return;
     }
+    if (m_policy == CapacityPolicy::PowerOfTwo && m_capacity != roundUpPowerOfTwo(m_capacity))
+    {
+        resizeBuffer(roundUpPowerOfTwo(m_capacity));
+    }
+    updateWrapMask();
+    endIndex = wrapIndex(frontIndex + m_length);
+}
 
-    m_length--;
-    endIndex = correctIndex(endIndex - 1);
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CapacityPolicy CircularDynamicArray<T, InlineSlots, Allocator, Access>::capacityPolicy() const
+{
+    return m_policy;
+}
 
-    if (m_length < m_capacity * .25)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::updateWrapMask()
+{
+    if (m_policy == CapacityPolicy::PowerOfTwo && m_capacity > 1 && (m_capacity & (m_capacity - 1)) == 0)
     {
-        shrinkArray();
+        m_wrapMask = m_capacity - 1;
+    }
+    else
+    {
+        m_wrapMask = 0;
     }
 }
 
-template <typename T>
-void CircularDynamicArray<T>::delFront()
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::roundUpPowerOfTwo(int n)
 {
-    if (m_length == 0)
+    int p = 1;
+    while (p < n)
+    {
+        p *= 2;
+    }
+    return p;
+}
+
+//growthFactor has to be above 1. shrinkThreshold has to be below 1 / 2 so that a halved array isn't
+//immediately full again, a lower value leaves more room before a queue that shrank has to grow back.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::setGrowthPolicy(double growthFactor, double shrinkThreshold)
+{
+    if (growthFactor <= 1 || shrinkThreshold < 0 || shrinkThreshold >= .5)
+    {
+        cout << "Invalid growth policy, growth factor must be above 1 and shrink threshold in [0, 0.5). Ignoring." << endl;
+        return;
+    }
+    m_growthFactor = growthFactor;
+    m_shrinkThreshold = shrinkThreshold;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+double CircularDynamicArray<T, InlineSlots, Allocator, Access>::growthFactor() const
+{
+    return m_growthFactor;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+double CircularDynamicArray<T, InlineSlots, Allocator, Access>::shrinkThreshold() const
+{
+    return m_shrinkThreshold;
+}
+
+//makes room for at least n elements, and keeps the array from shrinking below that until shrinkToFit is called
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::reserve(int n)
+{
+    m_minCapacity = n;
+    if (m_storage == StorageMode::Segmented)
+    {
+        //the blocks themselves are still allocated on demand, only the map is sized up front
+        while ((m_blockMapCapacity - 1) * BlockSize < n)
+        {
+            growBlockMap();
+        }
+        return;
+    }
+    if (n > m_capacity)
+    {
+        resizeBuffer(m_policy == CapacityPolicy::PowerOfTwo ? roundUpPowerOfTwo(n) : n);
+    }
+}
+
+//drops any reservation and gives back every slot that isn't holding an element
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::shrinkToFit()
+{
+    m_minCapacity = 0;
+    if (m_storage == StorageMode::Segmented)
+    {
+        releaseEmptyEndBlocks();
+        releaseBuffer(m_spareBlock, BlockSize);
+        m_spareBlock = nullptr;
+        return;
+    }
+    int newCapacity = m_policy == CapacityPolicy::PowerOfTwo ? roundUpPowerOfTwo(m_length) : m_length;
+    if (newCapacity < InlineSlots)
+    {
+        newCapacity = InlineSlots;
+    }
+    if (newCapacity < m_fixedCapacity)
+    {
+        newCapacity = m_fixedCapacity;
+    }
+    if (newCapacity != m_capacity)
+    {
+        resizeBuffer(newCapacity);
+    }
+    else
+    {
+        finishMigration();
+    }
+}
+
+//turns the array into a bounded "last n elements" buffer. once it holds capacity elements, addEnd drops the
+//front element to make room (and addFront the end one) instead of growing, so the buffer sized here is the
+//only one it uses and asSpans can read the window without copying. elements past the new capacity are
+//dropped from the front. 0 lets the array grow again. not available with segmented storage.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::setFixedCapacity(int capacity)
+{
+    if (capacity < 0)
+    {
+        cout << "Fixed capacity can't be negative! Aborting." << endl;
+        return;
+    }
+    m_fixedCapacity = capacity;
+    m_dropped = 0;
+    if (capacity == 0)
+    {
+        return;
+    }
+
+    if (m_storage == StorageMode::Segmented)
+    {
+        setStorageMode(StorageMode::Contiguous);
+    }
+    finishMigration();
+    if (m_length > capacity)
+    {
+        dropFront(m_length - capacity);
+    }
+    int newCapacity = capacity < InlineSlots ? InlineSlots : capacity;
+    if (newCapacity != m_capacity)
+    {
+        resizeBuffer(newCapacity);
+    }
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::fixedCapacity() const
+{
+    return m_fixedCapacity;
+}
+
+//number of elements dropped since setFixedCapacity, by adds into a full array or by the call itself
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+long long CircularDynamicArray<T, InlineSlots, Allocator, Access>::droppedCount() const
+{
+    return m_dropped;
+}
+
+//destroys the count oldest elements of a fixed capacity array. unlike delFront(n) it never resizes.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::dropFront(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        array[frontIndex].~T();
+        frontIndex = correctIndex(frontIndex + 1);
+    }
+    m_length -= count;
+    m_dropped += count;
+}
+
+//same as dropFront for the end
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::dropEnd(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        endIndex = correctIndex(endIndex - 1);
+        array[endIndex].~T();
+    }
+    m_length -= count;
+    m_dropped += count;
+}
+
+#pragma endregion AdjustSize
+
+#pragma region IncrementalResize
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::setResizeMode(ResizeMode mode)
+{
+    m_resizeMode = mode;
+    if (m_resizeMode == ResizeMode::Immediate)
+    {
+        finishMigration();
+    }
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+ResizeMode CircularDynamicArray<T, InlineSlots, Allocator, Access>::resizeMode() const
+{
+    return m_resizeMode;
+}
+
+//swaps in an empty buffer of the new capacity and leaves every element pending in the old one.
+//only the allocation happens here, the elements are moved a few at a time by migrateElements.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::beginIncrementalResize(int newCapacity)
+{
+    finishMigration();
+    if (m_length == 0)
+    {
+        resizeBuffer(newCapacity);
+        return;
+    }
+
+    m_oldArray = array;
+    m_oldCapacity = m_capacity;
+    m_oldFront = frontIndex;
+    m_pendingStart = 0;
+    m_pendingCount = m_length;
+
+    array = takeStorage(newCapacity);
+    m_capacity = newCapacity;
+    updateWrapMask();
+    frontIndex = 0;
+    endIndex = wrapIndex(m_length);
+
+    //the next resize is at least this many adds or deletes away, whatever the growth policy is.
+    //spreading the pending elements over them keeps every call O(1) and never leaves any for finishMigration.
+    int addsLeft = newCapacity - m_length;
+    int deletesLeft = m_length - (int)(newCapacity * m_shrinkThreshold);
+    int room = addsLeft < deletesLeft ? addsLeft : deletesLeft;
+    if (room < 1)
+    {
+        room = 1;
+    }
+    m_migrationStep = (m_pendingCount + room - 1) / room + 1;
+}
+
+//moves up to count pending elements from the front of the old buffer into their slots in the new one
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::migrateElements(int count)
+{
+    while (count > 0 && m_pendingCount > 0)
+    {
+        T &element = m_oldArray[m_oldFront];
+        ::new (static_cast<void *>(array + wrapIndex(frontIndex + m_pendingStart))) T(std::move(element));
+        element.~T();
+        m_oldFront = oldWrapIndex(m_oldFront + 1);
+        m_pendingStart++;
+        m_pendingCount--;
+        count--;
+    }
+
+    if (m_pendingCount == 0)
+    {
+        giveBackStorage(m_oldArray, m_oldCapacity);
+        m_oldArray = nullptr;
+        m_oldCapacity = 0;
+    }
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::finishMigration()
+{
+    if (m_oldArray != nullptr)
+    {
+        migrateElements(m_pendingCount);
+    }
+}
+
+#pragma endregion IncrementalResize
+
+#pragma region LinearAccess
+
+//returns the elements as one contiguous block of m_length elements, so sorts can work on plain pointers.
+//a contiguous buffer that wraps around is moved to the start of a fresh buffer once, a mirrored one is already
+//contiguous. segmented storage
+//is moved into a temporary buffer, releaseLinear has to be called afterwards to put it back.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T *CircularDynamicArray<T, InlineSlots, Allocator, Access>::linearize()
+{
+    if (m_storage == StorageMode::Segmented)
+    {
+        T *data = allocateBuffer(m_length);
+        for (int i = 0; i < m_length; i++)
+        {
+            T &element = blockElement(i);
+            ::new (static_cast<void *>(data + i)) T(std::move(element));
+            element.~T();
+        }
+        return data;
+    }
+
+    finishMigration();
+    if (frontIndex + m_length > m_capacity && m_storage != StorageMode::Mirrored)
+    {
+        resizeBuffer(m_capacity);
+    }
+    return array + frontIndex;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseLinear(T *data)
+{
+    if (m_storage != StorageMode::Segmented)
+    {
+        return;
+    }
+    for (int i = 0; i < m_length; i++)
+    {
+        ::new (static_cast<void *>(&blockElement(i))) T(std::move(data[i]));
+        data[i].~T();
+    }
+    releaseBuffer(data, m_length);
+}
+
+#pragma endregion LinearAccess
+
+#pragma region SegmentedStorage
+
+//moves every element into the other kind of storage. going back to Contiguous from Segmented sizes the buffer
+//to the current length, mirrored storage keeps its capacity either way.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::setStorageMode(StorageMode mode)
+{
+    if (mode == m_storage)
+    {
+        return;
+    }
+    if (mode == StorageMode::Segmented && m_fixedCapacity != 0)
+    {
+        cout << "A fixed capacity array can't be segmented. Keeping the current storage." << endl;
+        return;
+    }
+    if (m_storage == StorageMode::Mirrored)
+    {
+        leaveMirror();
+        if (mode == StorageMode::Contiguous)
+        {
+            return;
+        }
+    }
+    if (mode == StorageMode::Mirrored)
+    {
+        enterMirror();
+        return;
+    }
+
+    if (mode == StorageMode::Segmented)
+    {
+        finishMigration();
+        int count = m_length;
+        for (int i = 0; i < count; i++)
+        {
+            //m_length counts the elements already placed in blocks, getElement still reads the buffer
+            m_length = i;
+            T *slot = blockSlotForEnd();
+            T &element = array[wrapIndex(frontIndex + i)];
+            ::new (static_cast<void *>(slot)) T(std::move(element));
+            element.~T();
+        }
+        m_length = count;
+        giveBackStorage(array, m_capacity);
+        array = nullptr;
+        m_capacity = 0;
+        m_storage = StorageMode::Segmented;
+        updateWrapMask();
+        frontIndex = 0;
+        endIndex = 0;
+        return;
+    }
+
+    int newCapacity = m_length > 2 ? m_length : 2;
+    if (m_policy == CapacityPolicy::PowerOfTwo)
+    {
+        newCapacity = roundUpPowerOfTwo(newCapacity);
+    }
+    if (newCapacity < InlineSlots)
+    {
+        newCapacity = InlineSlots;
+    }
+    T *newArray = takeStorage(newCapacity);
+    for (int i = 0; i < m_length; i++)
+    {
+        T &element = blockElement(i);
+        ::new (static_cast<void *>(newArray + i)) T(std::move(element));
+        element.~T();
+    }
+    int count = m_length;
+    m_length = 0;
+    releaseBlocks();
+    m_length = count;
+    array = newArray;
+    m_capacity = newCapacity;
+    m_storage = StorageMode::Contiguous;
+    updateWrapMask();
+    frontIndex = 0;
+    endIndex = wrapIndex(m_length);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+StorageMode CircularDynamicArray<T, InlineSlots, Allocator, Access>::storageMode() const
+{
+    return m_storage;
+}
+
+//returns the (unconstructed) slot just past the last element, adding a block at the end of the map if needed
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T *CircularDynamicArray<T, InlineSlots, Allocator, Access>::blockSlotForEnd()
+{
+    int slot = m_blockOffset + m_length;
+    if ((slot >> BlockShift) == m_blockCount)
+    {
+        if (m_blockCount == m_blockMapCapacity)
+        {
+            growBlockMap();
+        }
+        m_blocks[(m_firstBlock + m_blockCount) & (m_blockMapCapacity - 1)] = takeBlock();
+        m_blockCount++;
+    }
+    return &blockElement(m_length);
+}
+
+//moves the front back by one and returns the (unconstructed) slot, adding a block at the front of the map if needed
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T *CircularDynamicArray<T, InlineSlots, Allocator, Access>::blockSlotForFront()
+{
+    if (m_blockOffset == 0)
+    {
+        if (m_blockCount == m_blockMapCapacity)
+        {
+            growBlockMap();
+        }
+        m_firstBlock = (m_firstBlock - 1) & (m_blockMapCapacity - 1);
+        m_blocks[m_firstBlock] = takeBlock();
+        m_blockCount++;
+        m_blockOffset = BlockSize;
+    }
+    m_blockOffset--;
+    return m_blocks[m_firstBlock] + m_blockOffset;
+}
+
+//called once the front element has been removed, frees the first block when nothing is left in it
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseFrontBlock()
+{
+    m_blockOffset++;
+    if (m_blockOffset == BlockSize)
+    {
+        giveBackBlock(m_blocks[m_firstBlock]);
+        m_firstBlock = (m_firstBlock + 1) & (m_blockMapCapacity - 1);
+        m_blockCount--;
+        m_blockOffset = 0;
+    }
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseEmptyEndBlocks()
+{
+    while (m_blockCount > 0 && m_blockOffset + m_length <= (m_blockCount - 1) * BlockSize)
+    {
+        m_blockCount--;
+        giveBackBlock(m_blocks[(m_firstBlock + m_blockCount) & (m_blockMapCapacity - 1)]);
+    }
+    if (m_blockCount == 0)
+    {
+        m_blockOffset = 0;
+    }
+}
+
+//only the block pointers are copied, the elements stay where they are
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::growBlockMap()
+{
+    int newMapCapacity = m_blockMapCapacity == 0 ? 8 : m_blockMapCapacity * 2;
+    T **newBlocks = allocateBlockMap(newMapCapacity);
+    for (int i = 0; i < m_blockCount; i++)
+    {
+        newBlocks[i] = m_blocks[(m_firstBlock + i) & (m_blockMapCapacity - 1)];
+    }
+    releaseBlockMap(m_blocks, m_blockMapCapacity);
+    m_blocks = newBlocks;
+    m_blockMapCapacity = newMapCapacity;
+    m_firstBlock = 0;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T *CircularDynamicArray<T, InlineSlots, Allocator, Access>::takeBlock()
+{
+    if (m_spareBlock != nullptr)
+    {
+        T *block = m_spareBlock;
+        m_spareBlock = nullptr;
+        return block;
+    }
+    return allocateBuffer(BlockSize);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::giveBackBlock(T *block)
+{
+    if (m_spareBlock == nullptr)
+    {
+        m_spareBlock = block;
+        return;
+    }
+    releaseBuffer(block, BlockSize);
+}
+
+//frees every block and the map, the elements must already be destroyed
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseBlocks()
+{
+    for (int i = 0; i < m_blockCount; i++)
+    {
+        releaseBuffer(m_blocks[(m_firstBlock + i) & (m_blockMapCapacity - 1)], BlockSize);
+    }
+    releaseBuffer(m_spareBlock, BlockSize);
+    releaseBlockMap(m_blocks, m_blockMapCapacity);
+    m_blocks = nullptr;
+    m_spareBlock = nullptr;
+    m_blockMapCapacity = 0;
+    m_firstBlock = 0;
+    m_blockCount = 0;
+    m_blockOffset = 0;
+}
+
+#pragma endregion SegmentedStorage
+
+#pragma region MirroredStorage
+
+//moves the elements into a new mirrored buffer with at least the current capacity. stays where it is, and
+//says so, when T can't be moved with memcpy or there is no memfd to map.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::enterMirror()
+{
+    if (!std::is_trivially_copyable<T>::value)
+    {
+        cout << "Mirrored storage needs a trivially copyable type. Keeping the current storage." << endl;
+        return;
+    }
+    finishMigration();
+    int capacity = m_storage == StorageMode::Segmented ? m_length : m_capacity;
+    size_t bytes = CircularDynamicArrayMirror::roundBytes((size_t)(capacity > 0 ? capacity : 1) * sizeof(T), sizeof(T));
+    int file;
+    T *ring = reinterpret_cast<T *>(CircularDynamicArrayMirror::map(bytes, file));
+    if (ring == nullptr)
+    {
+        cout << "Mirrored storage isn't available here. Keeping the current storage." << endl;
+        return;
+    }
+
+    for (int i = 0; i < m_length;)
+    {
+        const T *run;
+        int count = contiguousRun(i, run);
+        memcpy(static_cast<void *>(ring + i), run, count * sizeof(T));
+        i += count;
+    }
+    if (m_storage == StorageMode::Segmented)
+    {
+        int count = m_length;
+        m_length = 0;
+        releaseBlocks();
+        m_length = count;
+    }
+    else
+    {
+        giveBackStorage(array, m_capacity);
+    }
+    array = ring;
+    m_mirrorFile = file;
+    m_capacity = (int)(bytes / sizeof(T));
+    m_storage = StorageMode::Mirrored;
+    updateWrapMask();
+    frontIndex = 0;
+    endIndex = wrapIndex(m_length);
+}
+
+//copies the elements into an ordinary buffer of the same capacity and drops the mapping
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::leaveMirror()
+{
+    T *newArray = takeStorage(m_capacity);
+    relocateInto(newArray);
+    CircularDynamicArrayMirror::unmap(reinterpret_cast<char *>(array), (size_t)m_capacity * sizeof(T), m_mirrorFile);
+    array = newArray;
+    m_mirrorFile = -1;
+    m_storage = StorageMode::Contiguous;
+    frontIndex = 0;
+    endIndex = wrapIndex(m_length);
+}
+
+//drops the mapping of an array with no elements left and leaves it contiguous without a buffer
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::releaseMirror()
+{
+    CircularDynamicArrayMirror::unmap(reinterpret_cast<char *>(array), (size_t)m_capacity * sizeof(T), m_mirrorFile);
+    array = nullptr;
+    m_capacity = 0;
+    m_mirrorFile = -1;
+    m_storage = StorageMode::Contiguous;
+    updateWrapMask();
+    frontIndex = 0;
+    endIndex = 0;
+}
+
+//the capacity is rounded to whole pages. growing maps the bigger file again, so the pages already holding
+//elements aren't copied, only the shorter piece of a wrapped ring moves to keep the order. shrinking copies
+//into a new file.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::resizeMirror(int newCapacity)
+{
+    size_t bytes = (size_t)m_capacity * sizeof(T);
+    size_t newBytes = CircularDynamicArrayMirror::roundBytes((size_t)(newCapacity > 0 ? newCapacity : 1) * sizeof(T), sizeof(T));
+    if (newBytes == bytes)
+    {
+        return;
+    }
+
+    int oldCapacity = m_capacity;
+    if (newBytes > bytes)
+    {
+        char *base = CircularDynamicArrayMirror::remap(reinterpret_cast<char *>(array), bytes, newBytes, m_mirrorFile);
+        if (base == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        array = reinterpret_cast<T *>(base);
+        m_capacity = (int)(newBytes / sizeof(T));
+
+        int head = oldCapacity - frontIndex < m_length ? oldCapacity - frontIndex : m_length;
+        int wrapped = m_length - head;
+        if (wrapped > 0 && wrapped <= head && wrapped <= m_capacity - oldCapacity)
+        {
+            //the wrapped part goes right after the old end
+            memcpy(static_cast<void *>(array + oldCapacity), array, wrapped * sizeof(T));
+        }
+        else if (wrapped > 0)
+        {
+            //the front part goes up against the new end
+            memmove(static_cast<void *>(array + m_capacity - head), array + frontIndex, head * sizeof(T));
+            frontIndex = m_capacity - head;
+        }
+    }
+    else
+    {
+        int file;
+        T *ring = reinterpret_cast<T *>(CircularDynamicArrayMirror::map(newBytes, file));
+        if (ring == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        relocateInto(ring);
+        CircularDynamicArrayMirror::unmap(reinterpret_cast<char *>(array), bytes, m_mirrorFile);
+        array = ring;
+        m_mirrorFile = file;
+        m_capacity = (int)(newBytes / sizeof(T));
+        frontIndex = 0;
+    }
+    updateWrapMask();
+    endIndex = wrapIndex(frontIndex + m_length);
+}
+
+#pragma endregion MirroredStorage
+
+#pragma region AddDeleteElements
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::addEnd(const T &element)
+{
+    emplaceEnd(element);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::addEnd(T &&element)
+{
+    emplaceEnd(std::move(element));
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::addFront(const T &element)
+{
+    emplaceFront(element);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::addFront(T &&element)
+{
+    emplaceFront(std::move(element));
+}
+
+//constructs the new last element from args right in its slot and returns it. args may refer to an element
+//of this array, when the buffer has to grow the new element is built first so the reference is still good.
+//the element is handed back read only, the sortedness flag has already taken its value into account.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename... Args>
+const T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::emplaceEnd(Args &&...args)
+{
+    if (m_storage == StorageMode::Segmented)
+    {
+        T *slot = blockSlotForEnd();
+        ::new (static_cast<void *>(slot)) T(std::forward<Args>(args)...);
+        trackEnd(*slot);
+        m_length++;
+        return *slot;
+    }
+
+    if (m_length == m_fixedCapacity && m_fixedCapacity != 0)
+    {
+        //full and bounded, the oldest element makes room. the new one is built first in case args refer to it
+        T element(std::forward<Args>(args)...);
+        dropFront(1);
+        return emplaceEnd(std::move(element));
+    }
+
+    if (m_length == m_capacity)
+    {
+        T element(std::forward<Args>(args)...);
+        growArray();
+        return emplaceEnd(std::move(element));
+    }
+
+    T *slot = array + endIndex;
+    ::new (static_cast<void *>(slot)) T(std::forward<Args>(args)...);
+    trackEnd(*slot);
+    endIndex = correctIndex(endIndex + 1);
+    m_length++;
+
+    if (m_oldArray != nullptr)
+    {
+        migrateElements(m_migrationStep);
+    }
+    return *slot;
+}
+
+//same as emplaceEnd for the front
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename... Args>
+const T &CircularDynamicArray<T, InlineSlots, Allocator, Access>::emplaceFront(Args &&...args)
+{
+    if (m_length == 0)
+    {
+        return emplaceEnd(std::forward<Args>(args)...);
+    }
+
+    if (m_storage == StorageMode::Segmented)
+    {
+        T *slot = blockSlotForFront();
+        ::new (static_cast<void *>(slot)) T(std::forward<Args>(args)...);
+        //the slot is already element 0, the old front is element 1
+        if (m_sorted)
+        {
+            m_sorted = CircularDynamicArrayOrder<T>::inOrder(*slot, blockElement(1));
+        }
+        m_length++;
+        return *slot;
+    }
+
+    if (m_length == m_fixedCapacity && m_fixedCapacity != 0)
+    {
+        T element(std::forward<Args>(args)...);
+        dropEnd(1);
+        return emplaceFront(std::move(element));
+    }
+
+    if (m_length == m_capacity)
+    {
+        T element(std::forward<Args>(args)...);
+        growArray();
+        return emplaceFront(std::move(element));
+    }
+
+    int newFront = correctIndex(frontIndex - 1);
+    T *slot = array + newFront;
+    ::new (static_cast<void *>(slot)) T(std::forward<Args>(args)...);
+    trackFront(*slot);
+    frontIndex = newFront;
+    m_length++;
+
+    if (m_oldArray != nullptr)
+    {
+        m_pendingStart++;
+        migrateElements(m_migrationStep);
+    }
+    return *slot;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::delEnd()
+{
+    if (rejectAccess(m_length == 0, "CircularDynamicArray is empty"))
+    {
+        cout << "Trying to delete element from an empty array! Aborting." << endl;
+        return;
+    }
+
+    if (m_storage == StorageMode::Segmented)
+    {
+        blockElement(m_length - 1).~T();
+        m_length--;
+        releaseEmptyEndBlocks();
+        return;
+    }
+
+    m_length--;
+    endIndex = correctIndex(endIndex - 1);
+    if (m_pendingCount > 0 && m_pendingStart + m_pendingCount > m_length)
+    {
+        //the last element hasn't been moved out of the old buffer yet
+        m_oldArray[oldWrapIndex(m_oldFront + m_pendingCount - 1)].~T();
+        m_pendingCount--;
+    }
+    else
+    {
+        array[endIndex].~T();
+    }
+
+    if (shouldShrink())
+    {
+        shrinkArray();
+    }
+    else if (m_oldArray != nullptr)
+    {
+        migrateElements(m_migrationStep);
+    }
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::delFront()
+{
+    if (rejectAccess(m_length == 0, "CircularDynamicArray is empty"))
     {
         cout << "Trying to delete element from an empty array! Aborting." << endl;
         return;
     }
 
-    m_length--;
-    frontIndex = correctIndex(frontIndex + 1);
+    if (m_storage == StorageMode::Segmented)
+    {
+        blockElement(0).~T();
+        m_length--;
+        releaseFrontBlock();
+        return;
+    }
+
+    m_length--;
+    if (m_pendingCount > 0 && m_pendingStart == 0)
+    {
+        //the front element hasn't been moved out of the old buffer yet
+        m_oldArray[m_oldFront].~T();
+        m_oldFront = oldWrapIndex(m_oldFront + 1);
+        m_pendingCount--;
+    }
+    else
+    {
+        array[frontIndex].~T();
+        if (m_oldArray != nullptr)
+        {
+            m_pendingStart--;
+        }
+    }
+    frontIndex = correctIndex(frontIndex + 1);
+
+    if (shouldShrink())
+    {
+        shrinkArray();
+    }
+    else if (m_oldArray != nullptr)
+    {
+        migrateElements(m_migrationStep);
+    }
+}
+
+//appends n elements in order. the buffer is resized at most once and the elements are copied
+//into at most two contiguous pieces. elements must not point into this array.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::addEndRange(const T *elements, int n)
+{
+    if (n <= 0)
+    {
+        return;
+    }
+    if (m_fixedCapacity != 0 && m_length + n > m_fixedCapacity)
+    {
+        //only the newest m_fixedCapacity elements are kept, the oldest go from elements first and then from the front
+        if (n > m_fixedCapacity)
+        {
+            m_dropped += n - m_fixedCapacity;
+            elements += n - m_fixedCapacity;
+            n = m_fixedCapacity;
+        }
+        dropFront(m_length + n - m_fixedCapacity);
+    }
+    trackEnd(elements[0]);
+    for (int i = 1; m_sorted && i < n; i++)
+    {
+        m_sorted = CircularDynamicArrayOrder<T>::inOrder(elements[i - 1], elements[i]);
+    }
+
+    if (m_storage == StorageMode::Segmented)
+    {
+        while (n > 0)
+        {
+            T *slot = blockSlotForEnd();
+            int room = BlockSize - ((m_blockOffset + m_length) & (BlockSize - 1));
+            int count = room < n ? room : n;
+            copyConstruct(slot, elements, count);
+            m_length += count;
+            elements += count;
+            n -= count;
+        }
+        return;
+    }
+
+    finishMigration();
+    if (m_length + n > m_capacity)
+    {
+        resizeBuffer(fittedCapacity(m_length + n));
+    }
+
+    //a mirrored buffer takes the whole range in one piece
+    int first = m_capacity - endIndex < n && m_storage != StorageMode::Mirrored ? m_capacity - endIndex : n;
+    copyConstruct(array + endIndex, elements, first);
+    copyConstruct(array, elements + first, n - first);
+    m_length += n;
+    endIndex = wrapIndex(endIndex + n);
+}
+
+//prepends n elements so that afterwards the array starts with elements[0], elements[1], ..., elements[n - 1].
+//same single resize and two piece copy as addEndRange.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::addFrontRange(const T *elements, int n)
+{
+    if (n <= 0)
+    {
+        return;
+    }
+    if (m_fixedCapacity != 0 && m_length + n > m_fixedCapacity)
+    {
+        //the mirror image of addEndRange, the elements furthest from the front are dropped
+        if (n > m_fixedCapacity)
+        {
+            m_dropped += n - m_fixedCapacity;
+            n = m_fixedCapacity;
+        }
+        dropEnd(m_length + n - m_fixedCapacity);
+    }
+    trackFront(elements[n - 1]);
+    for (int i = 1; m_sorted && i < n; i++)
+    {
+        m_sorted = CircularDynamicArrayOrder<T>::inOrder(elements[i - 1], elements[i]);
+    }
+
+    if (m_storage == StorageMode::Segmented)
+    {
+        for (int i = n - 1; i >= 0; i--)
+        {
+            ::new (static_cast<void *>(blockSlotForFront())) T(elements[i]);
+            m_length++;
+        }
+        return;
+    }
+
+    finishMigration();
+    if (m_length + n > m_capacity)
+    {
+        resizeBuffer(fittedCapacity(m_length + n));
+    }
+
+    int newFront = wrapIndex(frontIndex - n);
+    int first = m_capacity - newFront < n && m_storage != StorageMode::Mirrored ? m_capacity - newFront : n;
+    copyConstruct(array + newFront, elements, first);
+    copyConstruct(array, elements + first, n - first);
+    m_length += n;
+    frontIndex = newFront;
+    endIndex = wrapIndex(frontIndex + m_length);
+}
+
+//removes the last n elements, shrinking at most once afterwards
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::delEnd(int n)
+{
+    if (rejectAccess(n < 0 || n > m_length, "CircularDynamicArray can't delete that many elements"))
+    {
+        cout << "Trying to delete a negative number of elements or more than the array holds! Aborting." << endl;
+        return;
+    }
+
+    if (m_storage == StorageMode::Segmented)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            blockElement(m_length - 1).~T();
+            m_length--;
+        }
+        releaseEmptyEndBlocks();
+        return;
+    }
+
+    finishMigration();
+    if (!std::is_trivially_destructible<T>::value)
+    {
+        for (int i = m_length - n; i < m_length; i++)
+        {
+            elementAt(i).~T();
+        }
+    }
+    m_length -= n;
+    endIndex = wrapIndex(frontIndex + m_length);
+
+    int newCapacity = fittedCapacity(m_length);
+    if (newCapacity != m_capacity)
+    {
+        resizeBuffer(newCapacity);
+    }
+}
+
+//removes the first n elements, shrinking at most once afterwards
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::delFront(int n)
+{
+    if (rejectAccess(n < 0 || n > m_length, "CircularDynamicArray can't delete that many elements"))
+    {
+        cout << "Trying to delete a negative number of elements or more than the array holds! Aborting." << endl;
+        return;
+    }
+
+    if (m_storage == StorageMode::Segmented)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            blockElement(0).~T();
+            m_length--;
+            releaseFrontBlock();
+        }
+        return;
+    }
+
+    finishMigration();
+    if (!std::is_trivially_destructible<T>::value)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            elementAt(i).~T();
+        }
+    }
+    m_length -= n;
+    frontIndex = wrapIndex(frontIndex + n);
+
+    int newCapacity = fittedCapacity(m_length);
+    if (newCapacity != m_capacity)
+    {
+        resizeBuffer(newCapacity);
+    }
+}
+
+#pragma endregion AddDeleteElements
+
+#pragma region PropertyGetters
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::length() const
+{
+    return m_length;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::capacity() const
+{
+    if (m_storage == StorageMode::Segmented)
+    {
+        return m_blockCount * BlockSize;
+    }
+    return m_capacity;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+Allocator CircularDynamicArray<T, InlineSlots, Allocator, Access>::allocator() const
+{
+    return m_allocator;
+}
+
+#pragma endregion PropertyGetters
+
+#pragma region Clear
+
+//removes every element but keeps the capacity, so it doesn't allocate and is O(1) for trivially destructible types
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::clear()
+{
+    destroyElements();
+    m_sorted = true;
+    m_blockOffset = 0;
+    frontIndex = 0;
+    endIndex = 0;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::clearCompletely(){
+    destroyElements();
+    m_sorted = true;
+    if (m_storage == StorageMode::Segmented)
+    {
+        releaseBlocks();
+        return;
+    }
+    if (m_fixedCapacity != 0)
+    {
+        //the fixed buffer is the only one the array may use
+        frontIndex = 0;
+        endIndex = 0;
+        return;
+    }
+    if (m_storage == StorageMode::Mirrored)
+    {
+        resizeMirror(2);
+        frontIndex = 0;
+        endIndex = 0;
+        return;
+    }
+    giveBackStorage(array, m_capacity);
+    m_capacity = InlineSlots > 2 ? InlineSlots : 2;
+    array = takeStorage(m_capacity);
+    updateWrapMask();
+    frontIndex = 0;
+    endIndex = 0;
+}
+
+#pragma endregion Clear
+
+#pragma region QuickSelect
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T CircularDynamicArray<T, InlineSlots, Allocator, Access>::QuickSelect(int k)
+{
+    if (k < 1 || k > m_length)
+    {
+        cout << "Error: k is out of range for QuickSelect." << endl;
+        return T();
+    }
+    if (isSorted())
+    {
+        return elementAt(k - 1);
+    }
+    return introSelect(0, m_length - 1, k - 1);
+}
+
+//quickselect as a loop instead of recursion. sorted or reverse sorted input is fine with a median of three pivot, and if
+//partitioning still hasn't narrowed the range down after 2 log n rounds the rest is left to the worst case O(n) select.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T CircularDynamicArray<T, InlineSlots, Allocator, Access>::introSelect(int left, int right, int k)
+{
+    int depthBudget = 0;
+    for (int n = right - left + 1; n > 0; n >>= 1)
+    {
+        depthBudget += 2;
+    }
+
+    while (left < right)
+    {
+        if (depthBudget-- == 0)
+        {
+            return wcRecursive(left, right, k);
+        }
+
+        int n = right - left + 1;
+        int pivot;
+        if (n > FloydRivestCutoff)
+        {
+            pivot = floydRivestPivot(left, right, k);
+        }
+        else if (n >= NintherCutoff)
+        {
+            //ninther: the median of three medians of three, spread over the range
+            int step = n / 8;
+            int middle = left + n / 2;
+            pivot = medianOfThree(medianOfThree(left, left + step, left + 2 * step),
+                                  medianOfThree(middle - step, middle, middle + step),
+                                  medianOfThree(right - 2 * step, right - step, right));
+        }
+        else
+        {
+            pivot = medianOfThree(left, left + n / 2, right);
+        }
+
+        //copied, the pivot moves while partitioning
+        T pivotElement = elementAt(pivot);
+        int equalStart, equalEnd;
+        partition(left, right, pivotElement, equalStart, equalEnd);
+
+        //k landing anywhere in the run of elements equal to the pivot is done, which keeps duplicates linear
+        if (k < equalStart)
+        {
+            right = equalStart - 1;
+        }
+        else if (k > equalEnd)
+        {
+            left = equalEnd + 1;
+        }
+        else
+        {
+            return pivotElement;
+        }
+    }
+    return elementAt(k);
+}
+
+//floyd-rivest: selects k within a small sample of the range around where k should end up, so the element that lands
+//on k is very close to the kth smallest of the whole range and partitioning on it leaves little to search.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::floydRivestPivot(int left, int right, int k)
+{
+    double n = right - left + 1;
+    double i = k - left + 1;
+    double z = log(n);
+    double s = 0.5 * exp(2 * z / 3);
+    double sd = 0.5 * sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1);
+    int sampleLeft = (int)(k - i * s / n + sd);
+    int sampleRight = (int)(k + (n - i) * s / n + sd);
+    introSelect(sampleLeft > left ? sampleLeft : left, sampleRight < right ? sampleRight : right, k);
+    return k;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::medianOfThree(int a, int b, int c)
+{
+    const T &x = elementAt(a);
+    const T &y = elementAt(b);
+    const T &z = elementAt(c);
+    if (x < y)
+    {
+        return y < z ? b : (x < z ? c : a);
+    }
+    return x < z ? a : (y < z ? c : b);
+}
+
+//the kth smallest elements for every k in ks (1 based, any order, repeats allowed), returned in the same order as ks.
+//one select on the middle requested k splits the array around it, so the requests below and above it only have to
+//search their own side. O(n log m) instead of m separate QuickSelects.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access> CircularDynamicArray<T, InlineSlots, Allocator, Access>::multiSelect(const int *ks, int m)
+{
+    CircularDynamicArray<T, InlineSlots, Allocator, Access> results(m_allocator);
+    int *positions = allocateScratch<int>(m);
+    for (int i = 0; i < m; i++)
+    {
+        if (ks[i] < 1 || ks[i] > m_length)
+        {
+            cout << "Error: k is out of range for multiSelect." << endl;
+            releaseScratch(positions, m);
+            return results;
+        }
+        positions[i] = ks[i] - 1;
+    }
+    std::sort(positions, positions + m);
+
+    if (!isSorted())
+    {
+        multiSelectRecursive(0, m_length - 1, positions, (int)(std::unique(positions, positions + m) - positions));
+    }
+    releaseScratch(positions, m);
+
+    //every requested position now holds its order statistic
+    results.reserve(m);
+    for (int i = 0; i < m; i++)
+    {
+        results.addEnd(elementAt(ks[i] - 1));
+    }
+    return results;
+}
+
+//positions is sorted, unique and inside [left, right]
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::multiSelectRecursive(int left, int right, const int *positions, int count)
+{
+    while (count > 0)
+    {
+        int middle = count / 2;
+        int k = positions[middle];
+        //leaves everything before k no larger and everything after it no smaller
+        introSelect(left, right, k);
+
+        multiSelectRecursive(left, k - 1, positions, middle);
+        left = k + 1;
+        positions += middle + 1;
+        count -= middle + 1;
+    }
+}
+
+//nearest rank quantiles, q in [0, 1]. quantile q is the ceil(q * n)th smallest element (the smallest for q = 0)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access> CircularDynamicArray<T, InlineSlots, Allocator, Access>::quantiles(const double *qs, int m)
+{
+    int *ks = allocateScratch<int>(m);
+    for (int i = 0; i < m; i++)
+    {
+        if (!(qs[i] >= 0 && qs[i] <= 1))
+        {
+            cout << "Error: quantiles have to be between 0 and 1." << endl;
+            releaseScratch(ks, m);
+            return CircularDynamicArray<T, InlineSlots, Allocator, Access>(m_allocator);
+        }
+        ks[i] = (int)ceil(qs[i] * m_length);
+        if (ks[i] < 1)
+        {
+            ks[i] = 1;
+        }
+    }
+    CircularDynamicArray<T, InlineSlots, Allocator, Access> results = multiSelect(ks, m);
+    releaseScratch(ks, m);
+    return results;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArray<T, InlineSlots, Allocator, Access> CircularDynamicArray<T, InlineSlots, Allocator, Access>::quantiles(std::initializer_list<double> qs)
+{
+    return quantiles(qs.begin(), (int)qs.size());
+}
+
+#pragma endregion QuickSelect
+
+#pragma region WorstCaseSelect
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T CircularDynamicArray<T, InlineSlots, Allocator, Access>::WCSelect(int k)
+{
+    //this is called expecting to return the kth smallest element in worst case O(n)
+
+    //step 1: logically break up into groups of 5
+    //step 2: sort the groups of 5 (relatively small number of comparisons. consider the middle element (in 0-4, its element 2))
+    //step 3: find the median of the medians
+    //step 4: partition on the median of medians
+    //step 5: recurse on left or right of partitions
+
+    if (k < 1 || k > m_length)
+    {
+        cout << "Error: k is out of range for WCSelect." << endl;
+        return T();
+    }
+    if (isSorted())
+    {
+        return elementAt(k - 1);
+    }
+    return wcRecursive(0, m_length - 1, k - 1);
+}
+
+//median of medians select on [left, right] without allocating anything. every group of 5 is sorted with a sorting
+//network and its median swapped down to the front of the range, so the medians end up in [left, left + groups)
+//where the median of medians is selected recursively. partitioning on it keeps at least 3/10 of the range on
+//each side, so the loop is O(n) in the worst case.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+T CircularDynamicArray<T, InlineSlots, Allocator, Access>::wcRecursive(int left, int right, int k)
+{
+    if (k < left || k > right)
+    {
+        return T();
+    }
+
+    while (right - left >= MergeSortRun)
+    {
+        int groups = 0;
+        for (int first = left; first + 4 <= right; first += 5)
+        {
+            sortFive(first);
+            swap(elementAt(left + groups), elementAt(first + 2));
+            groups++;
+        }
+
+        T medianOfMedians = wcRecursive(left, left + groups - 1, left + (groups - 1) / 2);
+
+        int equalStart, equalEnd;
+        partition(left, right, medianOfMedians, equalStart, equalEnd);
+
+        if (k < equalStart)
+        {
+            right = equalStart - 1;
+        }
+        else if (k > equalEnd)
+        {
+            left = equalEnd + 1;
+        }
+        else
+        {
+            return medianOfMedians;
+        }
+    }
+
+    //short enough to just sort
+    mergeSort(left, right);
+    return elementAt(k);
+}
+
+//optimal 9 comparator sorting network for the 5 elements starting at first
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::sortFive(int first)
+{
+    T &a = elementAt(first);
+    T &b = elementAt(first + 1);
+    T &c = elementAt(first + 2);
+    T &d = elementAt(first + 3);
+    T &e = elementAt(first + 4);
+    compareExchange(a, b);
+    compareExchange(d, e);
+    compareExchange(c, e);
+    compareExchange(c, d);
+    compareExchange(b, e);
+    compareExchange(a, d);
+    compareExchange(a, c);
+    compareExchange(b, d);
+    compareExchange(b, c);
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::compareExchange(T &a, T &b)
+{
+    if (b < a)
+    {
+        swap(a, b);
+    }
+}
+
+#pragma endregion WorstCaseSelect
+
+#pragma region Partition_and_Swap_Functions
+
+//three way (dutch national flag) partition of [left, right] around partitionElement. afterwards everything smaller is
+//in [left, equalStart), everything equal in [equalStart, equalEnd] and everything larger in (equalEnd, right].
+//only needs <, and lots of equal keys end up in one band instead of making selection quadratic.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::partition(int left, int right, const T &partitionElement, int &equalStart, int &equalEnd)
+{
+    int less = left, i = left, greater = right;
+    while (i <= greater)
+    {
+        T &element = elementAt(i);
+        if (element < partitionElement)
+        {
+            swap(element, elementAt(less));
+            less++;
+            i++;
+        }
+        else if (partitionElement < element)
+        {
+            swap(element, elementAt(greater));
+            greater--;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    equalStart = less;
+    equalEnd = greater;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::swap(T &a, T &b)
+{
+    T temp = std::move(a);
+    a = std::move(b);
+    b = std::move(temp);
+}
+
+#pragma endregion Partition_and_Swap_Functions
+
+#pragma region StableSort
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::stableSort()
+{
+    //the stable sort is going to be merge sort
+    mergeSort(0, m_length - 1);
+    m_sorted = true;
+}
+
+//sorts the logical range [left, right]. short ranges (what is left at the end of wcSelect) are insertion sorted
+//where they sit, anything longer is sorted on a contiguous view of the array.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::mergeSort(int left, int right)
+{
+    if (right - left < MergeSortRun)
+    {
+        for (int i = left + 1; i <= right; i++)
+        {
+            T value = std::move(elementAt(i));
+            int j = i;
+            while (j > left && value < elementAt(j - 1))
+            {
+                elementAt(j) = std::move(elementAt(j - 1));
+                j--;
+            }
+            elementAt(j) = std::move(value);
+        }
+        return;
+    }
+
+    T *data = linearize();
+    mergeSort(data, left, right);
+    releaseLinear(data);
+}
+
+//bottom up merge sort of array[left, right]. runs of MergeSortRun are insertion sorted, then runs are merged
+//pairwise back and forth between the array and one scratch buffer, doubling in width every pass.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::mergeSort(T* array, int left, int right)
+{
+    int length = right - left + 1;
+    if (length < 2)
+    {
+        return;
+    }
+
+    T *scratch = allocateBuffer(length);
+    sortRuns(array + left, length, scratch);
+    releaseBuffer(scratch, length);
+}
+
+//sorts array[0, length) using scratch[0, length) as uninitialized space for the merges. the result always ends up in array.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::sortRuns(T *array, int length, T *scratch)
+{
+    for (int start = 0; start < length; start += MergeSortRun)
+    {
+        insertionSort(array + start, length - start < MergeSortRun ? length - start : MergeSortRun);
+    }
+    if (length <= MergeSortRun)
+    {
+        return;
+    }
+
+    T *source = array;
+    T *destination = scratch;
+    for (int width = MergeSortRun; width < length; width *= 2)
+    {
+        for (int start = 0; start < length; start += 2 * width)
+        {
+            int middle = length - start < width ? length : start + width;
+            int end = length - middle < width ? length : middle + width;
+            mergeRuns(source + start, middle - start, source + middle, end - middle, destination + start);
+        }
+        T *temp = source;
+        source = destination;
+        destination = temp;
+    }
+
+    //an odd number of passes leaves the sorted elements in the scratch buffer
+    if (source != array)
+    {
+        moveConstruct(array, source, length);
+    }
+}
+
+//merges the sorted runs left and right into the uninitialized destination. elements are moved out of both runs,
+//so they are left uninitialized. ties go to the left run to keep it stable.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::mergeRuns(T *left, int leftLength, T *right, int rightLength, T *destination)
+{
+    int i = 0, j = 0, k = 0;
+
+    while (i < leftLength && j < rightLength)
+    {
+        if (left[i] <= right[j])
+        {
+            ::new (static_cast<void *>(destination + k)) T(std::move(left[i]));
+            left[i].~T();
+            i++;
+        }
+        else
+        {
+            ::new (static_cast<void *>(destination + k)) T(std::move(right[j]));
+            right[j].~T();
+            j++;
+        }
+        k++;
+    }
+
+    //whatever is left over in either run is already in order
+    moveConstruct(destination + k, left + i, leftLength - i);
+    k += leftLength - i;
+    moveConstruct(destination + k, right + j, rightLength - j);
+}
+
+//how many of the first k elements of merging left and right come from left, with ties going to left like mergeRuns.
+//binary search for the first i where left[i] belongs after right[k - i - 1].
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::coRank(int k, const T *left, int leftLength, const T *right, int rightLength)
+{
+    int low = k - rightLength > 0 ? k - rightLength : 0;
+    int high = k < leftLength ? k : leftLength;
+    while (low < high)
+    {
+        int i = low + (high - low) / 2;
+        if (left[i] <= right[k - i - 1])
+        {
+            low = i + 1;
+        }
+        else
+        {
+            high = i;
+        }
+    }
+    return low;
+}
+
+//same result as stableSort, split across threads (0 uses every hardware thread).
+//every thread sorts one chunk, then neighbouring runs are merged pairwise until one run is left. in every merge round
+//each thread owns an equal slice of the output, and finds where its slice starts in the two runs it falls in by co-ranking.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::parallelStableSort(int threads)
+{
+    threads = sortThreadCount(threads, m_length);
+    if (threads == 1)
+    {
+        stableSort();
+        return;
+    }
+    m_sorted = true;
+
+    int length = m_length;
+    T *data = linearize();
+    T *scratch = allocateBuffer(length);
+    int *runStarts = allocateScratch<int>(threads + 1);
+    int *splits = allocateScratch<int>(threads);
+    for (int t = 0; t <= threads; t++)
+    {
+        runStarts[t] = (int)((long long)length * t / threads);
+    }
+    int runs = threads;
+
+    runParallel(threads, [&](int t) {
+        sortRuns(data + runStarts[t], runStarts[t + 1] - runStarts[t], scratch + runStarts[t]);
+    });
 
-    if (m_length < m_capacity * .25)
+    T *source = data;
+    T *destination = scratch;
+    while (runs > 1)
     {
-        shrinkArray();
-    }
-}
+        //runs 2p and 2p + 1 are merged into [runStarts[2p], runStarts[2p + 2]). an odd run out is merged with nothing.
+        //the split points are all found before any thread starts moving elements out of source.
+        runParallel(threads, [&](int t) {
+            int position = (int)((long long)length * t / threads);
+            int pair = 0;
+            while (runStarts[pair + 2 < runs ? pair + 2 : runs] <= position)
+            {
+                pair += 2;
+            }
+            int start = runStarts[pair];
+            int middle = runStarts[pair + 1];
+            int end = runStarts[pair + 2 < runs ? pair + 2 : runs];
+            splits[t] = coRank(position - start, source + start, middle - start, source + middle, end - middle);
+        });
+
+        runParallel(threads, [&](int t) {
+            int low = (int)((long long)length * t / threads);
+            int high = (int)((long long)length * (t + 1) / threads);
+            for (int pair = 0; pair < runs; pair += 2)
+            {
+                int start = runStarts[pair];
+                int middle = runStarts[pair + 1];
+                int end = runStarts[pair + 2 < runs ? pair + 2 : runs];
+                int from = low > start ? low : start;
+                int to = high < end ? high : end;
+                if (from >= to)
+                {
+                    continue;
+                }
+                int leftFrom = from == start ? 0 : splits[t];
+                int leftTo = to == end ? middle - start : splits[t + 1];
+                int rightFrom = from - start - leftFrom;
+                int rightTo = to - start - leftTo;
+                mergeRuns(source + start + leftFrom, leftTo - leftFrom, source + middle + rightFrom, rightTo - rightFrom,
+                          destination + from);
+            }
+        });
+
+        int merged = 0;
+        for (int r = 0; r < runs; r += 2)
+        {
+            runStarts[merged++] = runStarts[r];
+        }
+        runStarts[merged] = length;
+        runs = merged;
 
-#pragma endregion AddDeleteElements
+        T *temp = source;
+        source = destination;
+        destination = temp;
+    }
 
-#pragma region PropertyGetters
+    if (source != data)
+    {
+        runParallel(threads, [&](int t) {
+            int low = (int)((long long)length * t / threads);
+            int high = (int)((long long)length * (t + 1) / threads);
+            moveConstruct(data + low, source + low, high - low);
+        });
+    }
 
-template <typename T>
-int CircularDynamicArray<T>::length() const
-{
-    return m_length;
+    releaseScratch(splits, threads);
+    releaseScratch(runStarts, threads + 1);
+    releaseBuffer(scratch, length);
+    releaseLinear(data);
 }
 
-template <typename T>
-int CircularDynamicArray<T>::capacity() const
+//stable insertion sort, quick for the short runs the merge sort starts from
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::insertionSort(T *array, int length)
 {
-    return m_capacity;
+    for (int i = 1; i < length; i++)
+    {
+        if (!(array[i] < array[i - 1]))
+        {
+            continue;
+        }
+        T value = std::move(array[i]);
+        int j = i;
+        do
+        {
+            array[j] = std::move(array[j - 1]);
+            j--;
+        } while (j > 0 && value < array[j - 1]);
+        array[j] = std::move(value);
+    }
 }
 
-#pragma endregion PropertyGetters
+#pragma endregion StableSort
 
-#pragma region Clear
+#pragma region RadixSort
 
-template <typename T>
-void CircularDynamicArray<T>::clear()
+//sorts the values in the array using radix sort on the low order i bits of the elm type.
+//when i covers the whole type the result is in numeric order, negative numbers first.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::radixSort(int i)
 {
-    delete[] array;
-    array = new T[2];
-    m_length = 2;
-    m_capacity = 2;
-    frontIndex = 0;
-    endIndex = 2;
-}
-
-template <typename T>
-void CircularDynamicArray<T>::clearCompletely(){
-    delete[] array;
-    array = new T[2];
-    m_length = 0;
-    m_capacity = 2;
-    frontIndex = 0;
-    endIndex = 0;
+    lsdRadixSort([](const T &element) { return element; }, i);
+    //sorting on only some of the bits doesn't put the values in order
+    m_sorted = i >= (int)(sizeof(T) * 8);
 }
 
-#pragma endregion Clear
-
-#pragma region QuickSelect
-
-template <typename T>
-T CircularDynamicArray<T>::QuickSelect(int k)
+//radix sorts on the integral value key returns for each element (all of its bits), for example
+//heap.radixSortBy([](const Node<int, string> &node) { return node.key; });
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename KeyFunction>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::radixSortBy(KeyFunction key)
 {
-    return qsRecursive(0, m_length - 1, k - 1);
+    typedef typename std::decay<decltype(key(std::declval<const T &>()))>::type Key;
+    lsdRadixSort(key, (int)(sizeof(Key) * 8));
+    m_sorted = false;
 }
 
-template <typename T>
-T CircularDynamicArray<T>::qsRecursive(int left, int right, int k)
+//stable lsd radix sort on the low order bits of key(element), one 8 bit digit per pass.
+//a single counting pass builds the histograms of every digit, and the elements go back and forth
+//between the linearized array and one scratch buffer.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename KeyFunction>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::lsdRadixSort(KeyFunction key, int bits)
 {
-    int pivot = partition(left, right);
+    typedef typename std::decay<decltype(key(std::declval<const T &>()))>::type Key;
+    static_assert(std::is_integral<Key>::value, "radix sort needs an integral key");
+    typedef typename std::make_unsigned<Key>::type UnsignedKey;
 
-    if (k < pivot)
-    {
-        return qsRecursive(left, pivot - 1, k);
-    }
-    else if (k > pivot)
+    UnsignedKey flip, mask;
+    radixKeyMasks<UnsignedKey, Key>(bits, flip, mask);
+    if (m_length < 2 || bits <= 0)
     {
-        return qsRecursive(pivot + 1, right, k);
-    }
-    else
-    {
-        return array[(pivot + frontIndex) % m_capacity];
+        return;
     }
-}
-
-#pragma endregion QuickSelect
-
-#pragma region WorstCaseSelect
-
-template <typename T>
-T CircularDynamicArray<T>::WCSelect(int k)
-{
-    //this is called expecting to return the kth smallest element in worst case O(n)
-
-    //step 1: logically break up into groups of 5
-    //step 2: sort the groups of 5 (relatively small number of comparisons. consider the middle element (in 0-4, its element 2))
-    //step 3: find the median of the medians
-    //step 4: partition on the median of medians
-    //step 5: recurse on left or right of partitions
-
-    return wcRecursive(0, m_length - 1, k - 1);
-}
+    int passes = (bits + RadixDigitBits - 1) / RadixDigitBits;
 
-//specifically for the main array
-template <typename T>
-T CircularDynamicArray<T>::wcRecursive(int left, int right, int k)
-{	
-	//make sure that k is smaller than the number of elements in the array  
-    if (k >= 0 && k <= right - left + 1)
-    {
-        int numElements = right - left + 1;
-
-        int i;
-        T *medians = new T[(numElements + 4) / 5];
-        for (i = 0; i < numElements / 5; i++)
-        { //there are i groups of 5
-            mergeSort(i * 5, (i * 5) + 4);
-            medians[i] = getElement((i * 5) + 2);
-        }
-        
-        //todo: catch case where elements are not exactly n % 5 = 0.
-        if(i * 5 < numElements){
-            mergeSort(i * 5, (i * 5) + (numElements % 5) - 1);
-            medians[i] = getElement((i * 5) + ((numElements % 5) / 2));
-            i++;
+    T *data = linearize();
+    int *counts = allocateScratch<int>(passes * RadixBuckets);
+    std::fill(counts, counts + passes * RadixBuckets, 0);
+    for (int i = 0; i < m_length; i++)
+    {
+        UnsignedKey k = ((UnsignedKey)key(data[i]) ^ flip) & mask;
+        for (int p = 0; p < passes; p++)
+        {
+            counts[p * RadixBuckets + ((k >> (p * RadixDigitBits)) & (RadixBuckets - 1))]++;
         }
+    }
 
-        //get the median of medians
-        mergeSort(medians, 0, i - 1);
+    T *scratch = allocateBuffer(m_length);
+    T *source = data;
+    T *destination = scratch;
+    for (int p = 0; p < passes; p++)
+    {
+        int shift = p * RadixDigitBits;
+        int *count = counts + p * RadixBuckets;
 
-        T medianOfMedians;
-        if(i == 1){
-            medianOfMedians = medians[i - 1];
-        }else{
-            medianOfMedians = medians[i / 2];
+        //a digit every element shares doesn't reorder anything
+        UnsignedKey firstKey = ((UnsignedKey)key(source[0]) ^ flip) & mask;
+        if (count[(firstKey >> shift) & (RadixBuckets - 1)] == m_length)
+        {
+            continue;
         }
-        
-        int positionOfMOM = partition(left, right, medianOfMedians);
 
-        if (k < positionOfMOM)
+        //turn the counts into the first slot of each bucket
+        int total = 0;
+        for (int b = 0; b < RadixBuckets; b++)
         {
-            return wcRecursive(left, positionOfMOM - 1, k);
+            int bucketCount = count[b];
+            count[b] = total;
+            total += bucketCount;
         }
-        else if (k > positionOfMOM)
+
+        for (int i = 0; i < m_length; i++)
         {
-            return wcRecursive(positionOfMOM + 1, right, k);
+            UnsignedKey k = ((UnsignedKey)key(source[i]) ^ flip) & mask;
+            int slot = count[(k >> shift) & (RadixBuckets - 1)]++;
+            ::new (static_cast<void *>(destination + slot)) T(std::move(source[i]));
         }
-        else
+        if (!std::is_trivially_destructible<T>::value)
         {
-            return getElement(positionOfMOM);
+            for (int i = 0; i < m_length; i++)
+            {
+                source[i].~T();
+            }
         }
-    }
-
-    if(left == right){
-        return getElement(left);
-	}
-	else if (k > left - right + 1) {
-		return getElement(k);
-	}
-
-	return -1;
-}
 
-#pragma endregion WorstCaseSelect
-
-#pragma region Partition_and_Swap_Functions
+        T *temp = source;
+        source = destination;
+        destination = temp;
+    }
 
-//partitions the array around the right most index (which could be anywhere, since the array is circular)
-template <typename T>
-int CircularDynamicArray<T>::partition(int left, int right)
-{
-    T pivotElement = getElement(right);
-    int partitionIndex = left;
-    for (int i = left; i < right; i++)
+    //an odd number of scatter passes leaves the sorted elements in the scratch buffer
+    if (source != data)
     {
-        if (getElement(i) < pivotElement)
+        for (int i = 0; i < m_length; i++)
         {
-            swap(getElement(i), getElement(partitionIndex));
-            partitionIndex++;
+            ::new (static_cast<void *>(data + i)) T(std::move(source[i]));
+            source[i].~T();
         }
     }
-    swap(getElement(partitionIndex), getElement(right));
-    return partitionIndex;
+
+    releaseBuffer(scratch, m_length);
+    releaseScratch(counts, passes * RadixBuckets);
+    releaseLinear(data);
 }
 
-template <typename T>
-int CircularDynamicArray<T>::partition(int left, int right, T partitionElement)
+//clamps bits to the width of the key and works out what is xor'ed into and masked out of every key.
+//sorting the whole of a signed key flips the sign bit so negative keys come first.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename UnsignedKey, typename Key>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::radixKeyMasks(int &bits, UnsignedKey &flip, UnsignedKey &mask)
 {
-    int partitionIndex;
-    for (partitionIndex = left; partitionIndex < right; partitionIndex++)
+    const int keyBits = (int)(sizeof(Key) * 8);
+    if (bits > keyBits)
     {
-        if (getElement(partitionIndex) == partitionElement)
-        {
-            break;
-        }
+        bits = keyBits;
     }
-    swap(getElement(partitionIndex), getElement(right));
-
-    partitionIndex = left;
-    for (int i = left; i < right; i++)
+    flip = 0;
+    if (bits == keyBits && std::is_signed<Key>::value)
     {
-        if (getElement(i) < partitionElement)
-        {
-            swap(getElement(i), getElement(partitionIndex));
-            partitionIndex++;
-        }
+        flip = (UnsignedKey)((UnsignedKey)1 << (keyBits - 1));
     }
-    swap(getElement(partitionIndex), getElement(right));
-    return partitionIndex;
+    mask = bits >= keyBits ? (UnsignedKey)~(UnsignedKey)0 : (UnsignedKey)(((UnsignedKey)1 << (bits > 0 ? bits : 0)) - 1);
 }
 
-template <typename T>
-void CircularDynamicArray<T>::swap(T &a, T &b)
+//same result as radixSort(i), split across threads (0 uses every hardware thread)
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::parallelRadixSort(int i, int threads)
 {
-    T temp = a;
-    a = b;
-    b = temp;
+    parallelLsdRadixSort([](const T &element) { return element; }, i, threads);
+    m_sorted = i >= (int)(sizeof(T) * 8);
 }
 
-#pragma endregion Partition_and_Swap_Functions
-
-#pragma region StableSort
-
-template <typename T>
-void CircularDynamicArray<T>::stableSort()
+//same result as radixSortBy(key), split across threads. key is called from several threads at once.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename KeyFunction>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::parallelRadixSortBy(KeyFunction key, int threads)
 {
-    //the stable sort is going to be merge sort
-    mergeSort(0, m_length - 1);
+    typedef typename std::decay<decltype(key(std::declval<const T &>()))>::type Key;
+    parallelLsdRadixSort(key, (int)(sizeof(Key) * 8), threads);
+    m_sorted = false;
 }
 
-//splits the array in half over and over until it gets to two elements, sorts those two elements, and then merges them together.
-template <typename T>
-void CircularDynamicArray<T>::mergeSort(int left, int right)
+//each pass splits the linearized array into one chunk per thread. every thread counts the digits of its chunk,
+//the per thread counts are prefix summed bucket by bucket (thread order inside a bucket keeps the sort stable),
+//and then every thread scatters its own chunk into the other buffer.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename KeyFunction>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::parallelLsdRadixSort(KeyFunction key, int bits, int threads)
 {
-    if (left < right)
+    threads = sortThreadCount(threads, m_length);
+    if (threads == 1)
     {
-        //get the middle index
-        int middle = (left + right) / 2;
+        lsdRadixSort(key, bits);
+        return;
+    }
 
-        //sort the left and right halves
-        mergeSort(left, middle);
-        mergeSort(middle + 1, right);
-        //merge the halves together
-        merge(left, middle, right);
+    typedef typename std::decay<decltype(key(std::declval<const T &>()))>::type Key;
+    static_assert(std::is_integral<Key>::value, "radix sort needs an integral key");
+    typedef typename std::make_unsigned<Key>::type UnsignedKey;
+
+    UnsignedKey flip, mask;
+    radixKeyMasks<UnsignedKey, Key>(bits, flip, mask);
+    if (bits <= 0)
+    {
+        return;
     }
-}
+    int passes = (bits + RadixDigitBits - 1) / RadixDigitBits;
+    int length = m_length;
 
-//merges elements at the indices given. does not adjust the circular array, so it's almost in place
-template <typename T>
-void CircularDynamicArray<T>::merge(int left, int middle, int right)
-{
-    //create temp arrays for each half
-    T *tempArray = new T[right - left + 1];
-    int i = left, j = middle + 1, k = 0;
+    T *data = linearize();
+    T *scratch = allocateBuffer(length);
+    T *source = data;
+    T *destination = scratch;
+    int *counts = allocateScratch<int>(threads * RadixBuckets);
 
-    while (i <= middle && j <= right)
+    for (int p = 0; p < passes; p++)
     {
-        if (getElement(i) <= getElement(j))
+        int shift = p * RadixDigitBits;
+        runParallel(threads, [&](int t) {
+            int *count = counts + t * RadixBuckets;
+            for (int b = 0; b < RadixBuckets; b++)
+            {
+                count[b] = 0;
+            }
+            int end = (int)((long long)length * (t + 1) / threads);
+            for (int i = (int)((long long)length * t / threads); i < end; i++)
+            {
+                count[((((UnsignedKey)key(source[i]) ^ flip) & mask) >> shift) & (RadixBuckets - 1)]++;
+            }
+        });
+
+        int total = 0;
+        bool allInOneBucket = false;
+        for (int b = 0; b < RadixBuckets; b++)
         {
-            tempArray[k] = getElement(i);
-            k++;
-            i++;
+            int bucketStart = total;
+            for (int t = 0; t < threads; t++)
+            {
+                int threadCount = counts[t * RadixBuckets + b];
+                counts[t * RadixBuckets + b] = total;
+                total += threadCount;
+            }
+            allInOneBucket = allInOneBucket || total - bucketStart == length;
         }
-        else
+        if (allInOneBucket)
         {
-            tempArray[k] = getElement(j);
-            k++;
-            j++;
+            continue;
         }
+
+        runParallel(threads, [&](int t) {
+            int *count = counts + t * RadixBuckets;
+            int end = (int)((long long)length * (t + 1) / threads);
+            for (int i = (int)((long long)length * t / threads); i < end; i++)
+            {
+                int slot = count[((((UnsignedKey)key(source[i]) ^ flip) & mask) >> shift) & (RadixBuckets - 1)]++;
+                ::new (static_cast<void *>(destination + slot)) T(std::move(source[i]));
+                source[i].~T();
+            }
+        });
+
+        T *temp = source;
+        source = destination;
+        destination = temp;
     }
 
-    //any elements that weren't compared are appended in, as they are in order already or will be compared later (left over elements)
-    while (i <= middle)
+    if (source != data)
     {
-        tempArray[k] = getElement(i);
-        k++;
-        i++;
+        runParallel(threads, [&](int t) {
+            int end = (int)((long long)length * (t + 1) / threads);
+            for (int i = (int)((long long)length * t / threads); i < end; i++)
+            {
+                ::new (static_cast<void *>(data + i)) T(std::move(source[i]));
+                source[i].~T();
+            }
+        });
     }
-    while (j <= right)
+
+    releaseScratch(counts, threads * RadixBuckets);
+    releaseBuffer(scratch, length);
+    releaseLinear(data);
+}
+
+//0 (or less) means one thread per hardware thread. never more threads than there are ParallelSortMinimum sized chunks.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::sortThreadCount(int threads, int length)
+{
+    if (threads <= 0)
     {
-        tempArray[k] = getElement(j);
-        k++;
-        j++;
+        threads = (int)std::thread::hardware_concurrency();
     }
-
-    //take everything in the temp array and put it where it goes.
-    for (i = left; i <= right; i++)
+    int useful = length / ParallelSortMinimum;
+    if (threads > useful)
     {
-        getElement(i) = tempArray[i - left];
+        threads = useful;
     }
+    return threads > 1 ? threads : 1;
 }
 
-template <typename T>
-void CircularDynamicArray<T>::mergeSort(T* array, int left, int right)
+//calls work(0) ... work(threads - 1) at the same time, the calling thread does work(0), and waits for all of them
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+template <typename Function>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::runParallel(int threads, Function work) const
 {
-    if (left < right)
+    std::thread *workers = allocateScratch<std::thread>(threads - 1);
+    for (int t = 1; t < threads; t++)
     {
-        //get the middle index
-        int middle = (left + right) / 2;
-
-        //sort the left and right halves
-        mergeSort(array, left, middle);
-        mergeSort(array, middle + 1, right);
-        //merge the halves together
-        merge(array, left, middle, right);
+        ::new (static_cast<void *>(workers + t - 1)) std::thread(work, t);
+    }
+    work(0);
+    for (int t = 1; t < threads; t++)
+    {
+        workers[t - 1].join();
+        workers[t - 1].~thread();
     }
+    releaseScratch(workers, threads - 1);
 }
 
-//merges elements at the indices given. does not adjust the circular array, so it's almost in place
-template <typename T>
-void CircularDynamicArray<T>::merge(T* array, int left, int middle, int right)
-{
-    //create temp arrays for each half
-    T *tempArray = new T[right - left + 1];
-    int i = left, j = middle + 1, k = 0;
+#pragma endregion RadixSort
 
-    while (i <= middle && j <= right)
-    {
-        if (array[i] <= array[j])
-        {
-            tempArray[k] = array[i];
-            k++;
-            i++;
+#pragma region SearchAlgos
+
+//whether every element is no smaller than the one before it. answered straight from the tracked state when the array
+//is known to be sorted, otherwise every run of storage is checked (vectorized like linearSearch) and the answer kept.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+bool CircularDynamicArray<T, InlineSlots, Allocator, Access>::isSorted() const
+{
+    if(!m_sorted){
+        bool sorted = true;
+        const T *previous = nullptr;
+        for(int index = 0; sorted && index < m_length;){
+            const T *run;
+            int runLength = contiguousRun(index, run);
+            sorted = (previous == nullptr || !(*run < *previous)) && CircularDynamicArrayScan<T>::sorted(run, runLength);
+            previous = run + runLength - 1;
+            index += runLength;
         }
-        else
-        {
-            tempArray[k] = array[j];
-            k++;
-            j++;
+        m_sorted = sorted;
+    }
+    return m_sorted;
+}
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::linearSearch(T key)
+{
+    //walk the contiguous pieces of storage directly so the scan needs no wrapping (and can be vectorized)
+    for(int index = 0; index < m_length;){
+        const T *run;
+        int runLength = contiguousRun(index, run);
+        int found = CircularDynamicArrayScan<T>::find(run, runLength, key);
+        if(found >= 0){
+            return index + found;
         }
+        index += runLength;
     }
+    return -1;
+}
 
-    //any elements that weren't compared are appended in, as they are in order already or will be compared later (left over elements)
-    while (i <= middle)
-    {
-        tempArray[k] = array[i];
-        k++;
-        i++;
+//how many elements are equal to key
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::count(T key) const
+{
+    int matches = 0;
+    for(int index = 0; index < m_length;){
+        const T *run;
+        int runLength = contiguousRun(index, run);
+        matches += CircularDynamicArrayScan<T>::count(run, runLength, key);
+        index += runLength;
     }
-    while (j <= right)
-    {
-        tempArray[k] = array[j];
-        k++;
-        j++;
+    return matches;
+}
+
+//adds the index of every element equal to key to the end of out, in order, and returns how many there were
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::findAll(T key, CircularDynamicArray<int> &out) const
+{
+    int matches = 0;
+    for(int index = 0; index < m_length;){
+        const T *run;
+        int runLength = contiguousRun(index, run);
+        int from = 0;
+        int found;
+        while((found = CircularDynamicArrayScan<T>::find(run + from, runLength - from, key)) >= 0){
+            out.addEnd(index + from + found);
+            from += found + 1;
+            matches++;
+        }
+        index += runLength;
     }
+    return matches;
+}
 
-    //take everything in the temp array and put it where it goes.
-    for (i = left; i <= right; i++)
-    {
-        array[i] = tempArray[i - left];
+//the first index holding key, or -1. the array has to be sorted.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::binSearch(T key)
+{
+    if(rejectUnsorted("binSearch needs a sorted array")){
+        return -1;
+    }
+    int index = lowerBound(key);
+    if(index < m_length && *probeAddress(index) == key){
+        return index;
     }
+    return -1;
 }
 
-#pragma endregion StableSort
+//the first index whose element is not less than key (m_length if there is none). the array has to be sorted.
+//the loop halves the range without branching on the comparison, and prefetches both places the next probe could be.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+int CircularDynamicArray<T, InlineSlots, Allocator, Access>::lowerBound(T key) const
+{
+    if(rejectUnsorted("lowerBound needs a sorted array")){
+        return m_length;
+    }
+    if(m_length == 0){
+        return 0;
+    }
+    int low = 0;
+    int n = m_length;
+    while(n > 1){
+        int half = n / 2;
+        int nextHalf = (n - half) / 2;
+        prefetch(probeAddress(low + nextHalf));
+        prefetch(probeAddress(low + half + nextHalf));
+        low = *probeAddress(low + half) < key ? low + half : low;
+        n -= half;
+    }
+    return low + (*probeAddress(low) < key);
+}
 
-#pragma region RadixSort
+//out[i] = binSearch(keys[i]). BatchSearchLanes searches run side by side, and since every search takes the same
+//number of steps, each one can prefetch its next probe while the others take their turn.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::binSearchBatch(const T *keys, int n, int *out) const
+{
+    if(rejectUnsorted("binSearchBatch needs a sorted array")){
+        for(int i = 0; i < n; i++){
+            out[i] = -1;
+        }
+        return;
+    }
+    int low[BatchSearchLanes];
+    for(int start = 0; start < n; start += BatchSearchLanes){
+        int lanes = n - start < BatchSearchLanes ? n - start : BatchSearchLanes;
+        for(int j = 0; j < lanes; j++){
+            low[j] = 0;
+        }
+        for(int remaining = m_length; remaining > 1;){
+            int half = remaining / 2;
+            int nextHalf = (remaining - half) / 2;
+            for(int j = 0; j < lanes; j++){
+                low[j] = *probeAddress(low[j] + half) < keys[start + j] ? low[j] + half : low[j];
+                prefetch(probeAddress(low[j] + nextHalf));
+            }
+            remaining -= half;
+        }
+        for(int j = 0; j < lanes; j++){
+            int index = m_length == 0 ? 0 : low[j] + (*probeAddress(low[j]) < keys[start + j]);
+            out[start + j] = index < m_length && *probeAddress(index) == keys[start + j] ? index : -1;
+        }
+    }
+}
 
-//sorts the values in the array using radix sort on the low order i bits of the elm type
-template <typename T>
-void CircularDynamicArray<T>::radixSort(int i)
+//address of element index for the binary searches. contiguous storage wraps with a conditional subtract
+//instead of going through elementAt, mirrored storage doesn't have to wrap at all.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+const T *CircularDynamicArray<T, InlineSlots, Allocator, Access>::probeAddress(int index) const
 {
-    for(int b = 0; b < i; b++){ //b is the current bit being sorted.
-        bitCountingSort(b);
+    if(m_storage == StorageMode::Mirrored){
+        return array + frontIndex + index;
     }
+    if(m_storage == StorageMode::Contiguous && m_oldArray == nullptr){
+        int slot = frontIndex + index;
+        return array + (slot >= m_capacity ? slot - m_capacity : slot);
+    }
+    return &elementAt(index);
+}
 
-    //TODO: Test negative numbers? 
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::prefetch(const T *element)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(element);
+#else
+    (void)element;
+#endif
 }
 
-//counting sort (stable) for radix sort, which takes in the argument b for which bit of the values of the array is being sorted on. 
-template <typename T>
-void CircularDynamicArray<T>::bitCountingSort(int b){
-    T* finalArray = new T[m_length];
-    int count[2] = {0};
+//whether a search has to refuse the array because it is out of order, reported like an out of bounds index.
+//isSorted is O(1) while the flag is set, so only a search after a write through a writable accessor scans,
+//and Unchecked trusts the caller without scanning at all.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+bool CircularDynamicArray<T, InlineSlots, Allocator, Access>::rejectUnsorted(const char *what) const
+{
+    if(Access == AccessPolicy::Unchecked){
+        return false;
+    }
+    if(rejectAccess(!isSorted(), what)){
+        cout << "Error: " << what << "." << endl;
+        return true;
+    }
+    return false;
+}
 
-    //get the counts of the 0s and 1s of the unsigned int cast 
-    for(int i = 0; i < m_length; i++){
-        unsigned int castedElement = (unsigned int)getElement(i);
-        unsigned int bitValue = (castedElement >> b) & 1; //shifts the unsigned int to the right b times, and bitwise ands it with 1
-        //cout << "current bit value of the " << b << "th bit for element " << getElement(i) << " is " << bitValue << endl;
-        count[bitValue]++;
+//read only copy of the (sorted) array laid out for fast searching, see CircularDynamicArraySearchIndex.
+//it takes its memory from the same allocator as the array.
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+CircularDynamicArraySearchIndex<T, Allocator> CircularDynamicArray<T, InlineSlots, Allocator, Access>::buildSearchIndex() const
+{
+    if(rejectUnsorted("buildSearchIndex needs a sorted array")){
+        return CircularDynamicArraySearchIndex<T, Allocator>(CircularDynamicArray<T, InlineSlots, Allocator, Access>(m_allocator));
     }
+    return CircularDynamicArraySearchIndex<T, Allocator>(*this);
+}
+
+#pragma endregion SearchAlgos
+
+#pragma region Print
+
+template <typename T, int InlineSlots, typename Allocator, AccessPolicy Access>
+void CircularDynamicArray<T, InlineSlots, Allocator, Access>::print()
+{
+    cout << "size is : " << m_length << endl
+         << "capacity is : " << m_capacity << endl
+         << "front index is: " << frontIndex << endl
+         << "end index is: " << endIndex << endl;
+    for (int i = 0; i < m_length; i++)
+        cout << elementAt(i) << " ";
+    cout << endl
+         << endl;
+}
+
+#pragma endregion Print
+
+#pragma region SearchIndex
 
-    //adjust the count array to be cumulative
-    count[1] += count[0];
+//a snapshot of a sorted CircularDynamicArray in eytzinger (breadth first) order: the root of the implicit search tree
+//is at 1 and the children of k are at 2k and 2k + 1. a search walks straight down the tree, so the next few levels
+//sit together in memory and can be prefetched, unlike the probes of a binary search which jump all over the array.
+//answers the same questions as binSearch and lowerBound, and doesn't see later changes to the array.
+//the keys and positions come from Allocator, the allocator of the array it was built from.
+template <typename T, typename Allocator>
+class CircularDynamicArraySearchIndex
+{
+public:
+    template <int InlineSlots, AccessPolicy Access>
+    explicit CircularDynamicArraySearchIndex(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &sorted);
+    CircularDynamicArraySearchIndex(const CircularDynamicArraySearchIndex &other);
+    CircularDynamicArraySearchIndex &operator=(const CircularDynamicArraySearchIndex &other);
+    ~CircularDynamicArraySearchIndex();
+    int length() const;
+    int lowerBound(const T &key) const;
+    int find(const T &key) const;
+    bool contains(const T &key) const;
+
+private:
+    //prefetch this many levels down, as many nodes as fit in a cache line
+    static const int CacheLine = 64;
+    static const int PrefetchNodes = sizeof(T) < CacheLine ? CacheLine / sizeof(T) : 1;
+
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char> ByteAllocator;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<int> PositionAllocator;
+
+    //m_keys starts on a cache line, so the PrefetchNodes descendants of a node that are prefetched together
+    //are exactly one line. m_keyBlock is the allocation of m_keyBytes bytes it sits in.
+    Allocator m_allocator;
+    unsigned char *m_keyBlock;
+    std::size_t m_keyBytes;
+    T *m_keys;
+    int *m_positions; //index in the sorted array of every node
+    int m_length;
+
+    template <int InlineSlots, AccessPolicy Access>
+    int fill(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &sorted, int node, int next);
+    int lowerBoundNode(const T &key) const;
+    void allocate();
+    void release();
+};
+
+template <typename T, typename Allocator>
+template <int InlineSlots, AccessPolicy Access>
+CircularDynamicArraySearchIndex<T, Allocator>::CircularDynamicArraySearchIndex(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &sorted)
+    : m_allocator(sorted.allocator())
+{
+    m_length = sorted.length();
+    allocate();
+    m_positions[0] = m_length;
+    fill(sorted, 1, 0);
+}
 
-    for(int i = m_length - 1; i >= 0; i--){
-        unsigned int castedElement = (unsigned int)getElement(i);
-        unsigned int bitValue = (castedElement >> b) & 1;
-        int locationOfElement = count[bitValue] - 1;
-        finalArray[locationOfElement] = getElement(i);
-        count[bitValue]--;
+template <typename T, typename Allocator>
+CircularDynamicArraySearchIndex<T, Allocator>::CircularDynamicArraySearchIndex(const CircularDynamicArraySearchIndex &other)
+    : m_allocator(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.m_allocator))
+{
+    m_length = other.m_length;
+    allocate();
+    for (int i = 0; i <= m_length; i++)
+    {
+        m_keys[i] = other.m_keys[i];
+        m_positions[i] = other.m_positions[i];
     }
+}
 
-    for(int i = 0; i < m_length; i++){
-        getElement(i) = finalArray[i];
+//keeps its own allocator, like an array that is assigned to
+template <typename T, typename Allocator>
+CircularDynamicArraySearchIndex<T, Allocator> &CircularDynamicArraySearchIndex<T, Allocator>::operator=(const CircularDynamicArraySearchIndex &other)
+{
+    if (this != &other)
+    {
+        release();
+        m_length = other.m_length;
+        allocate();
+        for (int i = 0; i <= m_length; i++)
+        {
+            m_keys[i] = other.m_keys[i];
+            m_positions[i] = other.m_positions[i];
+        }
     }
+    return *this;
+}
 
-	delete[] finalArray;
+template <typename T, typename Allocator>
+CircularDynamicArraySearchIndex<T, Allocator>::~CircularDynamicArraySearchIndex()
+{
+    release();
 }
 
-#pragma endregion RadixSort
+//room for m_length + 1 positions, and as many default constructed keys starting on a cache line
+template <typename T, typename Allocator>
+void CircularDynamicArraySearchIndex<T, Allocator>::allocate()
+{
+    std::size_t bytes = (m_length + 1) * sizeof(T);
+    std::size_t space = bytes + CacheLine;
+    ByteAllocator byteAllocator(m_allocator);
+    m_keyBytes = space;
+    m_keyBlock = std::allocator_traits<ByteAllocator>::allocate(byteAllocator, m_keyBytes);
+    void *aligned = m_keyBlock;
+    std::align(CacheLine, bytes, aligned, space);
+    m_keys = static_cast<T *>(aligned);
+    for (int i = 0; i <= m_length; i++)
+    {
+        ::new (static_cast<void *>(m_keys + i)) T();
+    }
 
-#pragma region SearchAlgos
+    PositionAllocator positionAllocator(m_allocator);
+    m_positions = std::allocator_traits<PositionAllocator>::allocate(positionAllocator, m_length + 1);
+}
 
-template <typename T>
-int CircularDynamicArray<T>::linearSearch(T key)
+template <typename T, typename Allocator>
+void CircularDynamicArraySearchIndex<T, Allocator>::release()
 {
-    int index;
-    for(index = 0; index < m_length; index++){
-        if(getElement(index) == key){
-            return index;
-        }
+    for (int i = 0; i <= m_length; i++)
+    {
+        m_keys[i].~T();
     }
-    return -1;
+    ByteAllocator byteAllocator(m_allocator);
+    std::allocator_traits<ByteAllocator>::deallocate(byteAllocator, m_keyBlock, m_keyBytes);
+    PositionAllocator positionAllocator(m_allocator);
+    std::allocator_traits<PositionAllocator>::deallocate(positionAllocator, m_positions, m_length + 1);
 }
 
-//assumes the array is sorted.
-template <typename T>
-int CircularDynamicArray<T>::binSearch(T key)
+//in order walk of the tree, which visits the nodes in sorted order. returns the next sorted index to place.
+template <typename T, typename Allocator>
+template <int InlineSlots, AccessPolicy Access>
+int CircularDynamicArraySearchIndex<T, Allocator>::fill(const CircularDynamicArray<T, InlineSlots, Allocator, Access> &sorted, int node, int next)
 {
-    return binSearchRecursive(0, m_length - 1, key);
+    if (node <= m_length)
+    {
+        next = fill(sorted, 2 * node, next);
+        m_keys[node] = sorted.getElement(next);
+        m_positions[node] = next;
+        next = fill(sorted, 2 * node + 1, next + 1);
+    }
+    return next;
 }
 
-template <typename T>
-int CircularDynamicArray<T>::binSearchRecursive(int left, int right, T key){
-    if(right >= left){
-        int middle = (left + right) / 2;
-        if(getElement(middle) == key){
-            return middle;
-        }else if(getElement(middle) > key){
-            return binSearchRecursive(left, middle - 1, key);
-        }else{
-            return binSearchRecursive(middle + 1, right, key);
+template <typename T, typename Allocator>
+int CircularDynamicArraySearchIndex<T, Allocator>::length() const
+{
+    return m_length;
+}
+
+//the node holding the first key not less than key, or 0 if there is none. going right adds a 1 bit to the path,
+//so the answer is where the path last went left: drop the trailing 1s and the 0 before them.
+template <typename T, typename Allocator>
+int CircularDynamicArraySearchIndex<T, Allocator>::lowerBoundNode(const T &key) const
+{
+    int node = 1;
+    while (node <= m_length)
+    {
+#if defined(__GNUC__)
+        if ((long long)node * PrefetchNodes <= m_length)
+        {
+            __builtin_prefetch(m_keys + node * PrefetchNodes);
         }
+#endif
+        node = 2 * node + (m_keys[node] < key);
     }
-    return -1;
+    while (node & 1)
+    {
+        node >>= 1;
+    }
+    return node >> 1;
 }
 
-#pragma endregion SearchAlgos
+//same as CircularDynamicArray::lowerBound on the array the index was built from
+template <typename T, typename Allocator>
+int CircularDynamicArraySearchIndex<T, Allocator>::lowerBound(const T &key) const
+{
+    return m_positions[lowerBoundNode(key)];
+}
 
-#pragma region Print
+//same as CircularDynamicArray::binSearch, the first index holding key or -1
+template <typename T, typename Allocator>
+int CircularDynamicArraySearchIndex<T, Allocator>::find(const T &key) const
+{
+    int node = lowerBoundNode(key);
+    return node != 0 && m_keys[node] == key ? m_positions[node] : -1;
+}
 
-template <typename T>
-void CircularDynamicArray<T>::print()
+template <typename T, typename Allocator>
+bool CircularDynamicArraySearchIndex<T, Allocator>::contains(const T &key) const
 {
-    cout << "size is : " << m_length << endl
-         << "capacity is : " << m_capacity << endl
-         << "front index is: " << frontIndex << endl
-         << "end index is: " << endIndex << endl;
-    for (int i = 0; i < m_length; i++)
-        cout << array[(i + frontIndex) % m_capacity] << " ";
-    cout << endl
-         << endl;
+    return find(key) >= 0;
 }
 
-#pragma endregion Print
\ No newline at end of file
+#pragma endregion SearchIndex
\ No newline at end of file
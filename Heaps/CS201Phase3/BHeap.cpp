@@ -12,73 +12,82 @@ public:
 		degree = 0;
 		child = sibling = parent = nullptr;
 	};
-	BNode(keytype key, valuetype value) : BNode() {
+	BNode(keytype key, valuetype value) : key(std::move(key)), value(std::move(value)) {
 		degree = 0;
-		this->key = key;
-		this->value = value;
-	};
-	~BNode(){
-		delete child;
-		delete sibling;
+		child = sibling = parent = nullptr;
 	};
 };
 
 #include "CircularDynamicArray.cpp"
 
-template<typename keytype, typename valuetype>
+//Allocator provides the memory for the nodes and the root list, e.g. an arena or a std::pmr allocator
+//for request scoped heaps. merge moves the nodes of H2 over, so merged heaps should use equal allocators.
+template<typename keytype, typename valuetype, typename Allocator = std::allocator<BNode<keytype, valuetype>>>
 class BHeap
 {
 public: 
 	BHeap();
-	BHeap(keytype k[], valuetype V[], int s);
+	explicit BHeap(const Allocator &allocator);
+	BHeap(keytype k[], valuetype V[], int s, const Allocator &allocator = Allocator());
 	~BHeap();
-	BHeap<keytype, valuetype>& operator= (const BHeap<keytype, valuetype> &other);
+	BHeap<keytype, valuetype, Allocator>& operator= (const BHeap<keytype, valuetype, Allocator> &other);
 	keytype peakKey();
 	valuetype peakValue();
 	keytype extractMin();
 	void insert(keytype k, valuetype v);
 	void insert(BNode<keytype, valuetype>* node);
-	void merge(BHeap<keytype, valuetype>& H2);
+	void merge(BHeap<keytype, valuetype, Allocator>& H2);
 	int arrayLength();
 	void printKey();
 	BNode<keytype, valuetype>* GetNodeByIndex(int i); //warning: dangerous
 	void RemovePointerAtIndex(int i);
 private:
-	CircularDynamicArray<BNode<keytype, valuetype>*> array;
+	//a heap of n nodes has at most log2(n) + 1 trees, so the root list (and the temporaries in merge and extractMin) stays inline
+	static const int RootSlots = 32;
+	typedef std::allocator_traits<Allocator> NodeTraits;
+	typedef typename NodeTraits::template rebind_alloc<BNode<keytype, valuetype>*> RootAllocator;
+	Allocator m_allocator;
+	//every index the heap uses is in range once the public functions have ruled out an empty heap, so the root list doesn't check them
+	CircularDynamicArray<BNode<keytype, valuetype>*, RootSlots, RootAllocator, AccessPolicy::Unchecked> array;
 	BNode<keytype, valuetype>* mergeTrees(BNode<keytype, valuetype>* b1, BNode<keytype, valuetype>* b2);
 	void insertExistingNode(BNode<keytype, valuetype>* node);
 	void fixBHeap();
 	void shiftArrayDownAt(int i);
 	void traversePrintTree(BNode<keytype, valuetype>* node);
+	void destroyTree(BNode<keytype, valuetype>* node);
 };
 
-template<typename keytype, typename valuetype>
-BHeap<keytype, valuetype>::BHeap() : array() {
+template<typename keytype, typename valuetype, typename Allocator>
+BHeap<keytype, valuetype, Allocator>::BHeap() : array() {
 }
 
-template <typename keytype, typename valuetype>
-BHeap<keytype, valuetype>::BHeap(keytype k[], valuetype V[], int s) : array()
+template<typename keytype, typename valuetype, typename Allocator>
+BHeap<keytype, valuetype, Allocator>::BHeap(const Allocator &allocator) : m_allocator(allocator), array(RootAllocator(allocator)) {
+}
+
+template <typename keytype, typename valuetype, typename Allocator>
+BHeap<keytype, valuetype, Allocator>::BHeap(keytype k[], valuetype V[], int s, const Allocator &allocator) : m_allocator(allocator), array(RootAllocator(allocator))
 {
 	for (int i = 0; i < s; i++) {
 		insert(k[i], V[i]);
 	}
 }
 
-template <typename keytype, typename valuetype>
-BHeap<keytype, valuetype>::~BHeap() {
+template <typename keytype, typename valuetype, typename Allocator>
+BHeap<keytype, valuetype, Allocator>::~BHeap() {
 	for (int i = 0; i < array.length(); i++) {
-		delete array[i];
+		destroyTree(array[i]);
 	}
 }
 
-template <typename keytype, typename valuetype>
-BHeap<keytype, valuetype>& BHeap<keytype, valuetype>::operator= (const BHeap<keytype, valuetype> &other) {
+template <typename keytype, typename valuetype, typename Allocator>
+BHeap<keytype, valuetype, Allocator>& BHeap<keytype, valuetype, Allocator>::operator= (const BHeap<keytype, valuetype, Allocator> &other) {
 	if (this == &other) {
 		return *this;
 	}
 
 	for (int i = 0; i < array.length(); i++) {
-		delete array[i];
+		destroyTree(array[i]);
 	}
 	array.clearCompletely();
 	for (int i = 0; i < other.arrayLength(); i++) {
@@ -87,23 +96,24 @@ BHeap<keytype, valuetype>& BHeap<keytype, valuetype>::operator= (const BHeap<key
 	return *this;
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::insert(keytype k, valuetype v) {
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::insert(keytype k, valuetype v) {
 	//cout << "Adding B0 Tree with a Key of " << k << endl;
-	BNode<keytype, valuetype> *node = new BNode<keytype, valuetype>(k, v);
+	BNode<keytype, valuetype> *node = NodeTraits::allocate(m_allocator, 1);
+	NodeTraits::construct(m_allocator, node, std::move(k), std::move(v));
 	array.addEnd(node);
 	fixBHeap();
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::insert(BNode<keytype, valuetype>* node) {
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::insert(BNode<keytype, valuetype>* node) {
 	//cout << "Adding B0 Tree with a Key of " << node->key << endl;
 	array.addEnd(node);
 	fixBHeap();
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::insertExistingNode(BNode<keytype, valuetype>* node)
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::insertExistingNode(BNode<keytype, valuetype>* node)
 {
 	node->parent = nullptr;
 	node->sibling = nullptr;
@@ -111,8 +121,8 @@ void BHeap<keytype, valuetype>::insertExistingNode(BNode<keytype, valuetype>* no
 	fixBHeap();
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::fixBHeap() {
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::fixBHeap() {
 	if (array.length() <= 1) return;
 
 	//printKey();
@@ -126,8 +136,8 @@ void BHeap<keytype, valuetype>::fixBHeap() {
 	}
 }
 
-template <typename keytype, typename valuetype>
-BNode<keytype, valuetype>* BHeap<keytype, valuetype>::mergeTrees(BNode<keytype, valuetype>* b1, BNode<keytype, valuetype>* b2) {
+template <typename keytype, typename valuetype, typename Allocator>
+BNode<keytype, valuetype>* BHeap<keytype, valuetype, Allocator>::mergeTrees(BNode<keytype, valuetype>* b1, BNode<keytype, valuetype>* b2) {
 	if (b1->key > b2->key) {
 		array.swap(b1, b2);
 		//cout << "Most recent tree added has a bigger key of " << b2->key << ", switching them in the array." << endl;
@@ -142,8 +152,8 @@ BNode<keytype, valuetype>* BHeap<keytype, valuetype>::mergeTrees(BNode<keytype,
 	return b1;
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::printKey() {
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::printKey() {
 	for (int i = array.length()-1; i >= 0; i--) {
 		cout << "B" << array[i]->degree << endl;
 		traversePrintTree(array[i]);
@@ -152,8 +162,8 @@ void BHeap<keytype, valuetype>::printKey() {
 	cout << endl;
 }
 
-template <typename keytype, typename valuetype>
-void BHeap <keytype, valuetype>::traversePrintTree(BNode<keytype, valuetype>* node) {
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap <keytype, valuetype, Allocator>::traversePrintTree(BNode<keytype, valuetype>* node) {
 	cout << node->key << " ";
 	if (node->child != nullptr) {
 		traversePrintTree(node->child);
@@ -164,8 +174,12 @@ void BHeap <keytype, valuetype>::traversePrintTree(BNode<keytype, valuetype>* no
 	}
 }
 
-template <typename keytype, typename valuetype>
-keytype BHeap<keytype, valuetype>::peakKey() {
+template <typename keytype, typename valuetype, typename Allocator>
+keytype BHeap<keytype, valuetype, Allocator>::peakKey() {
+	if (array.length() == 0) {
+		cout << "Trying to peak at an empty heap! Aborting." << endl;
+		return keytype();
+	}
 	BNode<keytype, valuetype>* smallestNode = array[0];
 	for (int i = 0; i < array.length(); i++) {
 		if (array[i]->key < smallestNode->key) {
@@ -176,8 +190,13 @@ keytype BHeap<keytype, valuetype>::peakKey() {
 	return smallestNode->key;
 }
 
-template <typename keytype, typename valuetype>
-keytype BHeap<keytype, valuetype>::extractMin() {
+template <typename keytype, typename valuetype, typename Allocator>
+keytype BHeap<keytype, valuetype, Allocator>::extractMin() {
+	//the array doesn't check indices, so an empty heap has to be caught here
+	if (array.length() == 0) {
+		cout << "Trying to extract from an empty heap! Aborting." << endl;
+		return keytype();
+	}
 	//find the smallest node
 	BNode<keytype, valuetype>* smallestNode = array[0];
 	int indexOfSmallest = 0;
@@ -195,7 +214,7 @@ keytype BHeap<keytype, valuetype>::extractMin() {
 	//remove the reference to the children from the min and vice versa
 	BNode<keytype, valuetype>* child = smallestNode->child;
 	BNode<keytype, valuetype>* tempChild;
-	BHeap<keytype, valuetype> tempHeap;
+	BHeap<keytype, valuetype, Allocator> tempHeap(m_allocator);
 
 	while (child != nullptr) {
 		tempChild = child; //this extra pointer is so we can remove the reference to the sibling once we move on to the sibling
@@ -221,13 +240,13 @@ keytype BHeap<keytype, valuetype>::extractMin() {
 	//get the key, delete the node, return the key. 
 	keytype k = smallestNode->key;
 	smallestNode->child = nullptr;
-	delete smallestNode;
+	destroyTree(smallestNode);
 	return k;
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::merge(BHeap<keytype, valuetype> &H2) {
-	CircularDynamicArray<BNode<keytype, valuetype>*> temp;
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::merge(BHeap<keytype, valuetype, Allocator> &H2) {
+	CircularDynamicArray<BNode<keytype, valuetype>*, RootSlots, RootAllocator, AccessPolicy::Unchecked> temp(array.allocator());
 
 	int i = 0;
 	int j = 0;
@@ -263,8 +282,12 @@ void BHeap<keytype, valuetype>::merge(BHeap<keytype, valuetype> &H2) {
 	//printKey();
 }
 
-template <typename keytype, typename valuetype>
-valuetype BHeap<keytype, valuetype>::peakValue() {
+template <typename keytype, typename valuetype, typename Allocator>
+valuetype BHeap<keytype, valuetype, Allocator>::peakValue() {
+	if (array.length() == 0) {
+		cout << "Trying to peak at an empty heap! Aborting." << endl;
+		return valuetype();
+	}
 	BNode<keytype, valuetype>* smallestNode = array[0];
 	for (int i = 0; i < array.length(); i++) {
 		if (array[i]->key < smallestNode->key) {
@@ -275,25 +298,45 @@ valuetype BHeap<keytype, valuetype>::peakValue() {
 	return smallestNode->value;
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::shiftArrayDownAt(int i) {
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::shiftArrayDownAt(int i) {
 	for (int j = i; j < array.length() - 1; j++) {
 		array[j] = array[j + 1];
 	}
 	array.delEnd();
 }
 
-template <typename keytype, typename valuetype>
-BNode<keytype, valuetype>* BHeap<keytype, valuetype>::GetNodeByIndex(int i) {
+template <typename keytype, typename valuetype, typename Allocator>
+BNode<keytype, valuetype>* BHeap<keytype, valuetype, Allocator>::GetNodeByIndex(int i) {
+	if (i < 0 || i >= array.length()) {
+		cout << "Trying to get a root past the end of the root list! Aborting." << endl;
+		return nullptr;
+	}
 	return array[i];
 }
 
-template <typename keytype, typename valuetype>
-void BHeap<keytype, valuetype>::RemovePointerAtIndex(int i) {
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::RemovePointerAtIndex(int i) {
+	if (i < 0 || i >= array.length()) {
+		cout << "Trying to remove a root past the end of the root list! Aborting." << endl;
+		return;
+	}
 	array[i] = nullptr;
 }
 
-template <typename keytype, typename valuetype>
-int BHeap<keytype, valuetype>::arrayLength() {
+template <typename keytype, typename valuetype, typename Allocator>
+int BHeap<keytype, valuetype, Allocator>::arrayLength() {
 	return array.length();
+}
+
+//gives a node, its children and its siblings back to the allocator
+template <typename keytype, typename valuetype, typename Allocator>
+void BHeap<keytype, valuetype, Allocator>::destroyTree(BNode<keytype, valuetype>* node) {
+	while (node != nullptr) {
+		BNode<keytype, valuetype>* sibling = node->sibling;
+		destroyTree(node->child);
+		NodeTraits::destroy(m_allocator, node);
+		NodeTraits::deallocate(m_allocator, node, 1);
+		node = sibling;
+	}
 }
\ No newline at end of file
@@ -11,20 +11,20 @@ public:
 	Node() {
 		
 	};
-	Node(keytype key, valuetype value) {
-		this->key = key;
-		this->value = value;
+	Node(keytype key, valuetype value) : key(std::move(key)), value(std::move(value)) {
 	};
 };
 
 
 
-template <typename keytype, typename valuetype>
+//Allocator provides the memory for the node array, e.g. an arena or a std::pmr allocator for request scoped heaps
+template <typename keytype, typename valuetype, typename Allocator = std::allocator<Node<keytype, valuetype>>>
 class Heap
 {
 public:
 	Heap();
-	Heap(keytype k[], valuetype V[], int s);
+	explicit Heap(const Allocator &allocator);
+	Heap(keytype k[], valuetype V[], int s, const Allocator &allocator = Allocator());
 	~Heap();
 	keytype peakKey();
 	valuetype peakValue();
@@ -33,21 +33,28 @@ public:
 	void printKey();
 private:
 	int m_size = 0;
-	CircularDynamicArray<Node<keytype, valuetype>> array;
+	//every index the heap uses is in range once the public functions have ruled out an empty heap, so the array doesn't check them
+	CircularDynamicArray<Node<keytype, valuetype>, 0, Allocator, AccessPolicy::Unchecked> array;
 	int parentIndex(int i);
 	int leftChildIndex(int i);
 	int rightChildIndex(int i);
 	void heapify(int i);
 };
 
-template <typename keytype, typename valuetype>
-Heap<keytype, valuetype>::Heap() : array()
+template <typename keytype, typename valuetype, typename Allocator>
+Heap<keytype, valuetype, Allocator>::Heap() : array()
 {
 	m_size = 0;
 }
 
-template <typename keytype, typename valuetype>
-Heap<keytype, valuetype>::Heap(keytype k[], valuetype V[], int s) : array()
+template <typename keytype, typename valuetype, typename Allocator>
+Heap<keytype, valuetype, Allocator>::Heap(const Allocator &allocator) : array(allocator)
+{
+	m_size = 0;
+}
+
+template <typename keytype, typename valuetype, typename Allocator>
+Heap<keytype, valuetype, Allocator>::Heap(keytype k[], valuetype V[], int s, const Allocator &allocator) : array(allocator)
 {
 	//bottom up heap building from clrs for O(n) runtimes
 
@@ -55,8 +62,7 @@ Heap<keytype, valuetype>::Heap(keytype k[], valuetype V[], int s) : array()
 	
 	//add nodes in order that they are in the array
 	for (int i = 0; i < s; i++) {
-		Node<keytype, valuetype> node(k[i], V[i]);
-		array.addEnd(node);
+		array.emplaceEnd(k[i], V[i]);
 	}
 
 	//for every non-leaf node, heapify (find the smallest between a node and it's children, flip it if necesary. )
@@ -65,17 +71,16 @@ Heap<keytype, valuetype>::Heap(keytype k[], valuetype V[], int s) : array()
 	}
 }
 
-template <typename keytype, typename valuetype>
-Heap<keytype, valuetype>::~Heap()
+template <typename keytype, typename valuetype, typename Allocator>
+Heap<keytype, valuetype, Allocator>::~Heap()
 {
 
 }
 
-template <typename keytype, typename valuetype>
-void Heap<keytype, valuetype>::insert(keytype k, valuetype v) {
+template <typename keytype, typename valuetype, typename Allocator>
+void Heap<keytype, valuetype, Allocator>::insert(keytype k, valuetype v) {
 	m_size++;
-	Node<keytype, valuetype> node(k, v);
-	array.addEnd(node);
+	array.emplaceEnd(std::move(k), std::move(v));
 
 	int i = m_size - 1;
 	while (i != 0 && array[parentIndex(i)].key > array[i].key) {
@@ -85,35 +90,50 @@ void Heap<keytype, valuetype>::insert(keytype k, valuetype v) {
 	}
 }
 
-template<typename keytype, typename valuetype>
-keytype Heap<keytype, valuetype>::peakKey() {
+template<typename keytype, typename valuetype, typename Allocator>
+keytype Heap<keytype, valuetype, Allocator>::peakKey() {
+	if (m_size == 0) {
+		cout << "Trying to peak at an empty heap! Aborting." << endl;
+		return keytype();
+	}
 	return array[0].key;
 }
 
-template<typename keytype, typename valuetype>
-valuetype Heap<keytype, valuetype>::peakValue() {
+template<typename keytype, typename valuetype, typename Allocator>
+valuetype Heap<keytype, valuetype, Allocator>::peakValue() {
+	if (m_size == 0) {
+		cout << "Trying to peak at an empty heap! Aborting." << endl;
+		return valuetype();
+	}
 	return array[0].value;
 }
 
-template<typename keytype, typename valuetype>
-keytype Heap<keytype, valuetype>::extractMin() {
+template<typename keytype, typename valuetype, typename Allocator>
+keytype Heap<keytype, valuetype, Allocator>::extractMin() {
+	//the array doesn't check indices, so an empty heap has to be caught here
+	if (m_size == 0) {
+		cout << "Trying to extract from an empty heap! Aborting." << endl;
+		return keytype();
+	}
 	//pop the front, delete it. 
-	Node<keytype, valuetype> front = array[0];
+	Node<keytype, valuetype> front = std::move(array[0]);
 	array.delFront();
 	m_size--;
 	
 	//move the end to the front
-	Node<keytype, valuetype> end = array[m_size - 1];
-	array.addFront(end);
-	array.delEnd();
+	if (m_size > 0) {
+		Node<keytype, valuetype> end = std::move(array[m_size - 1]);
+		array.delEnd();
+		array.addFront(std::move(end));
+	}
 
 	heapify(0);
 
-	return front.key;
+	return std::move(front.key);
 }
 
-template<typename keytype, typename valuetype>
-void Heap<keytype, valuetype>::heapify(int i) {
+template<typename keytype, typename valuetype, typename Allocator>
+void Heap<keytype, valuetype, Allocator>::heapify(int i) {
 	int smallest = i;
 	int left = leftChildIndex(i);
 	int right = rightChildIndex(i);
@@ -133,25 +153,25 @@ void Heap<keytype, valuetype>::heapify(int i) {
 }
 
 //returns the index of the parent given a current child index in the array.
-template <typename keytype, typename valuetype>
-int Heap<keytype, valuetype>::parentIndex(int i) {
+template <typename keytype, typename valuetype, typename Allocator>
+int Heap<keytype, valuetype, Allocator>::parentIndex(int i) {
 	return (i - 1) / 2;
 }
 
 //returns the index of the left child given a current parent index in the array.
-template <typename keytype, typename valuetype>
-int Heap<keytype, valuetype>::leftChildIndex(int i) {
+template <typename keytype, typename valuetype, typename Allocator>
+int Heap<keytype, valuetype, Allocator>::leftChildIndex(int i) {
 	return (2 * i) + 1;
 }
 
 //returns the index of the right child given a current parent index in the array.
-template <typename keytype, typename valuetype>
-int Heap<keytype, valuetype>::rightChildIndex(int i) {
+template <typename keytype, typename valuetype, typename Allocator>
+int Heap<keytype, valuetype, Allocator>::rightChildIndex(int i) {
 	return (2 * i) + 2;
 }
 
-template <typename keytype, typename valuetype>
-void Heap<keytype, valuetype>::printKey() {
+template <typename keytype, typename valuetype, typename Allocator>
+void Heap<keytype, valuetype, Allocator>::printKey() {
 	for (int i = 0; i < m_size; i++) {
 		cout << array[i].key << " ";
 	}